@@ -0,0 +1,47 @@
+#!/bin/bash
+
+# Compare the read(), O_DIRECT, io_uring and mmap paths on a hot and a cold page cache
+# Build first with ./build.sh
+
+FILE=$1
+THREADS=${2:-$(nproc)}
+CHUNK_KB=${3:-1024}
+READER=./parallel_reader
+
+if [ -z "$FILE" ]; then
+    echo "Usage: $0 <filename> [num_threads] [read_chunk_size_KB]"
+    exit 1
+fi
+
+if [ ! -x "$READER" ]; then
+    echo "$READER not found, run ./build.sh first"
+    exit 1
+fi
+
+# Evict the file from the page cache (GNU dd issues posix_fadvise DONTNEED for
+# nocache with count=0). As root, "echo 3 > /proc/sys/vm/drop_caches" is stronger
+drop_cache() {
+    dd if="$FILE" iflag=nocache count=0 2>/dev/null
+}
+
+warm_cache() {
+    cat "$FILE" > /dev/null
+}
+
+echo "File: $FILE ($(stat -c %s "$FILE") bytes), $THREADS threads, ${CHUNK_KB} KB chunks"
+printf "%-6s %-10s %-6s %15s %15s\n" "cache" "o_direct" "engine" "read (ms)" "MB/s"
+
+for cache in hot cold; do
+    for config in "0 sync" "1 sync" "0 uring" "1 uring" "0 mmap"; do
+        set -- $config
+        if [ "$cache" = "hot" ]; then
+            warm_cache
+        else
+            drop_cache
+        fi
+        output=$("$READER" "$FILE" "$THREADS" "$CHUNK_KB" "$1" "$2")
+        ms=$(echo "$output" | sed -n 's/^Read completed in \([0-9]*\) ms/\1/p')
+        mbs=$(echo "$output" | sed -n 's/^Throughput: \(.*\) MB\/s/\1/p')
+        printf "%-6s %-10s %-6s %15s %15s\n" "$cache" "$1" "$2" "$ms" "$mbs"
+    done
+done
@@ -1,8 +1,12 @@
 read(3, "\217-\243C\275\\~\\\2453\343\247\234#\215\355\304\352\3\234Zz\351\rR\\\237\343\250\377\243\275"..., 62277111808) = 2147479552 <0.859589>
 #!/bin/bash
 
-# Compile the parallel file reader
-g++ -std=c++17 -O2 -pthread -o parallel_reader reader.cpp
+# Compile the parallel file reader, with the HDF5 VDS reader (--vds) if libhdf5 is installed
+HDF5_FLAGS=""
+if pkg-config --exists hdf5 2>/dev/null; then
+    HDF5_FLAGS="-DWITH_HDF5 $(pkg-config --cflags --libs hdf5)"
+fi
+g++ -std=c++17 -O2 -pthread -o parallel_reader reader.cc $HDF5_FLAGS
 
 if [ $? -eq 0 ]; then
     echo "Compilation successful!"
@@ -1,13 +1,896 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <functional>
 #include <cstring>
 #include <sys/stat.h>
 #include <chrono>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstdlib>
+#include <climits>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstdint>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#include <linux/mempolicy.h>
+#include <linux/mman.h>
+#include <sched.h>
+#ifdef WITH_HDF5
+#include <hdf5.h>
+#endif
+
+// Backend used by each reader thread to issue its reads
+enum class IoEngine {
+    Sync,     // One blocking ::read per chunk
+    IoUring,  // Many reads in flight per thread through an io_uring
+    Mmap      // Map the file and prefault disjoint ranges; the mapping is the buffer
+};
+
+// How the file is divided among reader threads
+enum class Scheduler {
+    Static,   // One contiguous section of file_size / num_threads bytes per thread
+    Dynamic   // Threads claim chunks from a shared cursor until the file is consumed
+};
+
+// Minimal io_uring wrapper over the raw syscalls (no liburing dependency)
+class IoUring {
+private:
+    int ring_fd = -1;
+    unsigned entries = 0;
+
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_len = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_len = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_len = 0;
+
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+
+    unsigned sqe_tail = 0;   // Next SQE slot to hand out
+    unsigned submitted = 0;  // SQEs already published to the kernel
+
+public:
+    explicit IoUring(unsigned queue_depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+        if (ring_fd < 0) {
+            throw std::runtime_error("io_uring_setup failed: " + std::string(strerror(errno)));
+        }
+        entries = params.sq_entries;
+
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        }
+
+        sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            close(ring_fd);
+            throw std::runtime_error("Failed to map io_uring submission queue");
+        }
+        if (single_mmap) {
+            cq_ptr = sq_ptr;
+        } else {
+            cq_ptr = mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) {
+                munmap(sq_ptr, sq_len);
+                close(ring_fd);
+                throw std::runtime_error("Failed to map io_uring completion queue");
+            }
+        }
+
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            if (cq_ptr != sq_ptr) munmap(cq_ptr, cq_len);
+            munmap(sq_ptr, sq_len);
+            close(ring_fd);
+            throw std::runtime_error("Failed to map io_uring SQE array");
+        }
+
+        char* sq = static_cast<char*>(sq_ptr);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        char* cq = static_cast<char*>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        sqe_tail = submitted = *sq_tail;
+    }
+
+    ~IoUring() {
+        munmap(sqes, sqes_len);
+        if (cq_ptr != sq_ptr) munmap(cq_ptr, cq_len);
+        munmap(sq_ptr, sq_len);
+        close(ring_fd);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    unsigned size() const {
+        return entries;
+    }
+
+    // Get a zeroed SQE to fill in; it is queued until the next submit()
+    io_uring_sqe* getSqe() {
+        if (sqe_tail - submitted >= entries) {
+            return nullptr;
+        }
+        unsigned index = sqe_tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        ++sqe_tail;
+        return sqe;
+    }
+
+    void prepRead(io_uring_sqe* sqe, int fd, void* dest, unsigned length, size_t offset, uint64_t user_data) {
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(dest);
+        sqe->len = length;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+    }
+
+    // Same as prepRead, but into a buffer registered with registerBuffers()
+    void prepReadFixed(io_uring_sqe* sqe, int fd, void* dest, unsigned length, size_t offset,
+                       unsigned buf_index, uint64_t user_data) {
+        prepRead(sqe, fd, dest, length, offset, user_data);
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = static_cast<uint16_t>(buf_index);
+    }
+
+    // Pin buffers once so READ_FIXED skips per-I/O page pinning; returns 0 or -errno
+    int registerBuffers(const iovec* iovecs, unsigned count) {
+        int rc = static_cast<int>(syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, iovecs, count));
+        return rc < 0 ? -errno : 0;
+    }
+
+    // Unpin the buffers of the last registerBuffers() so others can be registered
+    int unregisterBuffers() {
+        int rc = static_cast<int>(syscall(__NR_io_uring_register, ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0));
+        return rc < 0 ? -errno : 0;
+    }
+
+    // Register descriptors so SQEs can refer to them by index with IOSQE_FIXED_FILE
+    int registerFiles(const int* fds, unsigned count) {
+        int rc = static_cast<int>(syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, fds, count));
+        return rc < 0 ? -errno : 0;
+    }
+
+    // Publish queued SQEs and optionally wait for at least wait_nr completions
+    int submit(unsigned wait_nr = 0) {
+        unsigned to_submit = sqe_tail - submitted;
+        __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+        submitted = sqe_tail;
+        unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+        int rc;
+        do {
+            rc = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags, nullptr, 0));
+            to_submit = 0;  // Anything before an EINTR was already consumed
+        } while (rc < 0 && errno == EINTR);
+        return rc < 0 ? -errno : rc;
+    }
+
+    // Fetch the next completion, if any; call cqeSeen() once it is handled
+    io_uring_cqe* peekCqe() {
+        unsigned head = *cq_head;
+        if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+        return &cqes[head & *cq_mask];
+    }
+
+    void cqeSeen() {
+        __atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+    }
+};
+
+// How the destination buffer's pages get faulted in before they hold file data
+enum class BufferInit {
+    Memset,     // Zero the whole buffer with parallel memset before reading
+    FirstTouch  // Let each reader thread fault in the pages it reads into
+};
+
+// Page size backing the destination buffer
+enum class HugePages {
+    None,         // Regular 4 KB pages
+    Transparent,  // 2 MB aligned allocation with madvise(MADV_HUGEPAGE)
+    Huge2MB,      // MAP_HUGETLB with 2 MB pages, falling back to Transparent
+    Huge1GB       // MAP_HUGETLB with 1 GB pages, falling back to Transparent
+};
+
+// Where buffer pages are placed across NUMA nodes
+enum class NumaPolicy {
+    None,        // Kernel default (pages land on whichever node touches them first)
+    Local,       // Bind each thread's section of buffer to that thread's node
+    Interleave   // Spread buffer pages round-robin over all nodes
+};
+
+// Which CPUs a reader thread is allowed to run on
+enum class ThreadPinning {
+    None,   // Threads float freely
+    Node,   // Thread i runs on any CPU of node i % nodes
+    Core    // Thread i runs on a single CPU, i % cpus
+};
+
+// posix_fadvise hint for buffered reads
+enum class CacheAdvice {
+    None,        // Leave the kernel's defaults alone
+    Normal,      // POSIX_FADV_NORMAL on the whole file
+    Sequential,  // POSIX_FADV_SEQUENTIAL: doubles the kernel readahead window
+    Random,      // POSIX_FADV_RANDOM: disables kernel readahead
+    NoReuse,     // POSIX_FADV_NOREUSE: data is read once
+    WillNeed     // POSIX_FADV_WILLNEED on each section before it is read
+};
+
+// Online NUMA nodes and their CPUs, read from sysfs
+class NumaTopology {
+private:
+    std::vector<int> node_ids;
+    std::vector<std::vector<int>> node_cpus;
+
+    // Parse a sysfs list such as "0-3,8,10-11"
+    static std::vector<int> parseList(const std::string& list) {
+        std::vector<int> values;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t comma = list.find(',', pos);
+            std::string range = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            size_t dash = range.find('-');
+            if (!range.empty()) {
+                int first = std::stoi(range);
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int value = first; value <= last; ++value) {
+                    values.push_back(value);
+                }
+            }
+            if (comma == std::string::npos) {
+                break;
+            }
+            pos = comma + 1;
+        }
+        return values;
+    }
+
+    static std::string readSysfs(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+public:
+    NumaTopology() {
+        for (int node : parseList(readSysfs("/sys/devices/system/node/online"))) {
+            std::vector<int> cpus = parseList(readSysfs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+            if (!cpus.empty()) {
+                node_ids.push_back(node);
+                node_cpus.push_back(cpus);
+            }
+        }
+        if (node_ids.empty()) {
+            // No sysfs NUMA information: treat the machine as one node
+            std::vector<int> cpus;
+            for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+            node_ids.push_back(0);
+            node_cpus.push_back(cpus);
+        }
+    }
+
+    size_t numNodes() const {
+        return node_ids.size();
+    }
+
+    const std::vector<int>& cpus(size_t index) const {
+        return node_cpus[index];
+    }
+
+    // Index of the node owning a CPU
+    size_t nodeOfCpu(int cpu) const {
+        for (size_t i = 0; i < node_cpus.size(); ++i) {
+            if (std::find(node_cpus[i].begin(), node_cpus[i].end(), cpu) != node_cpus[i].end()) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    std::vector<int> allCpus() const {
+        std::vector<int> all;
+        for (const auto& cpus : node_cpus) {
+            all.insert(all.end(), cpus.begin(), cpus.end());
+        }
+        return all;
+    }
+
+    // Apply a memory policy to the whole pages of [addr, addr + length) for the
+    // given node indexes; returns 0 or -errno
+    int bind(void* addr, size_t length, int mode, const std::vector<size_t>& nodes) const {
+        size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t start = (reinterpret_cast<uintptr_t>(addr) + page_size - 1) / page_size * page_size;
+        uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + length) / page_size * page_size;
+        if (end <= start) {
+            return 0;
+        }
+
+        const size_t bits = 8 * sizeof(unsigned long);
+        int max_node = *std::max_element(node_ids.begin(), node_ids.end());
+        std::vector<unsigned long> mask(max_node / bits + 1, 0);
+        for (size_t index : nodes) {
+            int node = node_ids[index];
+            mask[node / bits] |= 1UL << (node % bits);
+        }
+        long rc = syscall(__NR_mbind, start, end - start, mode, mask.data(), mask.size() * bits + 1, MPOL_MF_MOVE);
+        return rc < 0 ? -errno : 0;
+    }
+};
+
+// Long-lived worker threads; lets a reader (or several) run many read() calls
+// without creating and joining threads each time
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    bool stopping = false;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                job_ready.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t size) {
+        for (size_t i = 0; i < std::max<size_t>(size, 1); ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        job_ready.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // Completion tracker for one batch of tasks handed to start()
+    class Batch {
+    private:
+        std::mutex mutex;
+        std::condition_variable all_done;
+        size_t remaining;
+        std::function<void(size_t)> task;
+
+        friend class ThreadPool;
+
+    public:
+        Batch(size_t count, std::function<void(size_t)> batch_task)
+            : remaining(count), task(std::move(batch_task)) {}
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            all_done.wait(lock, [this]() { return remaining == 0; });
+        }
+
+        bool finished() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return remaining == 0;
+        }
+    };
+
+    // Queue task(0) .. task(count - 1) on the workers and return without waiting
+    std::shared_ptr<Batch> start(size_t count, std::function<void(size_t)> task) {
+        auto batch = std::make_shared<Batch>(count, std::move(task));
+        if (count == 0) {
+            return batch;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < count; ++i) {
+                jobs.emplace_back([batch, i]() {
+                    batch->task(i);
+                    std::lock_guard<std::mutex> done_lock(batch->mutex);
+                    if (--batch->remaining == 0) {
+                        batch->all_done.notify_all();
+                    }
+                });
+            }
+        }
+        job_ready.notify_all();
+        return batch;
+    }
+
+    // Run task(0) .. task(count - 1) on the workers and wait for all of them
+    void run(size_t count, const std::function<void(size_t)>& task) {
+        start(count, task)->wait();
+    }
+};
+
+// Completion state of one read_async(): which chunks of the buffer hold file data
+// yet, and whether the whole read has finished. Ranges are tracked at chunk
+// granularity, so a range is ready once every chunk it touches is complete
+class ReadProgress {
+private:
+    std::mutex mutex;
+    std::condition_variable progressed;
+    size_t chunk_size;
+    size_t file_size;
+    std::vector<size_t> chunk_bytes;  // Bytes of each chunk read so far
+    size_t bytes_read = 0;
+    bool done = false;
+    std::exception_ptr error;
+
+    size_t chunkLength(size_t index) const {
+        return std::min(chunk_size, file_size - index * chunk_size);
+    }
+
+    bool readyLocked(size_t offset, size_t length) const {
+        if (length == 0) {
+            return true;
+        }
+        size_t end = std::min(offset + length, file_size);
+        for (size_t index = offset / chunk_size; index * chunk_size < end; ++index) {
+            if (chunk_bytes[index] < chunkLength(index)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    ReadProgress(size_t chunk, size_t size)
+        : chunk_size(chunk), file_size(size), chunk_bytes((size + chunk - 1) / chunk, 0) {}
+
+    // Reader threads: [offset, offset + length) now holds file data. Every byte is
+    // reported once, so per-chunk byte counts are enough to detect completion
+    void add(size_t offset, size_t length) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t end = offset + length;
+        while (offset < end) {
+            size_t index = offset / chunk_size;
+            size_t piece = std::min(end, (index + 1) * chunk_size) - offset;
+            chunk_bytes[index] += piece;
+            offset += piece;
+        }
+        bytes_read += length;
+        progressed.notify_all();
+    }
+
+    void finish(std::exception_ptr read_error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        error = read_error;
+        progressed.notify_all();
+    }
+
+    // Poll: is [offset, offset + length) of the buffer already filled?
+    bool rangeReady(size_t offset, size_t length) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return readyLocked(offset, length);
+    }
+
+    // Block until [offset, offset + length) is filled; false if the read ended without filling it
+    bool waitRange(size_t offset, size_t length) {
+        std::unique_lock<std::mutex> lock(mutex);
+        progressed.wait(lock, [&]() { return done || readyLocked(offset, length); });
+        return readyLocked(offset, length);
+    }
+
+    // Block until the whole read has finished; rethrows a read() failure.
+    // Returns true if every byte of the file was read
+    bool wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        progressed.wait(lock, [this]() { return done; });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return readyLocked(0, file_size);
+    }
+
+    bool finished() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return done;
+    }
+
+    size_t bytesRead() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bytes_read;
+    }
+};
+
+// CRC32C (Castagnoli), using the SSE4.2 crc32 instruction when the CPU has it.
+// Values are finalized CRCs, as with zlib's crc32(), so pieces computed separately
+// can be joined with combine() into the CRC of the concatenation
+class Crc32c {
+private:
+    static constexpr uint32_t polynomial = 0x82f63b78;  // Reflected Castagnoli polynomial
+
+    static const uint32_t* table() {
+        static uint32_t entries[8][256];
+        static bool ready = [&]() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc >> 1) ^ (crc & 1 ? polynomial : 0);
+                }
+                entries[0][i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (int k = 1; k < 8; ++k) {
+                    entries[k][i] = (entries[k - 1][i] >> 8) ^ entries[0][entries[k - 1][i] & 0xff];
+                }
+            }
+            return true;
+        }();
+        (void)ready;
+        return &entries[0][0];
+    }
+
+    // Slicing-by-8 fallback
+    static uint32_t software(uint32_t crc, const unsigned char* data, size_t length) {
+        const uint32_t* t = table();
+        while (length >= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            word ^= crc;
+            crc = t[7 * 256 + (word & 0xff)] ^ t[6 * 256 + ((word >> 8) & 0xff)]
+                ^ t[5 * 256 + ((word >> 16) & 0xff)] ^ t[4 * 256 + ((word >> 24) & 0xff)]
+                ^ t[3 * 256 + ((word >> 32) & 0xff)] ^ t[2 * 256 + ((word >> 40) & 0xff)]
+                ^ t[1 * 256 + ((word >> 48) & 0xff)] ^ t[(word >> 56) & 0xff];
+            data += 8;
+            length -= 8;
+        }
+        while (length-- > 0) {
+            crc = (crc >> 8) ^ t[(crc ^ *data++) & 0xff];
+        }
+        return crc;
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("sse4.2")))
+    static uint32_t hardware(uint32_t crc, const unsigned char* data, size_t length) {
+        uint64_t crc64 = crc;
+        while (length >= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            crc64 = __builtin_ia32_crc32di(crc64, word);
+            data += 8;
+            length -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+        while (length-- > 0) {
+            crc = __builtin_ia32_crc32qi(crc, *data++);
+        }
+        return crc;
+    }
+
+    // The crc32 instruction has a latency of 3 cycles but issues every cycle, so run
+    // three independent streams over thirds of the data and join them afterwards
+    __attribute__((target("sse4.2")))
+    static uint32_t hardware3(uint32_t crc, const unsigned char* data, size_t length) {
+        size_t third = length / 3 / 8 * 8;
+        const unsigned char* a = data;
+        const unsigned char* b = data + third;
+        const unsigned char* c = data + 2 * third;
+        uint64_t crc_a = crc;
+        uint64_t crc_b = 0xffffffff;
+        uint64_t crc_c = 0xffffffff;
+        for (size_t i = 0; i < third; i += 8) {
+            uint64_t word_a, word_b, word_c;
+            std::memcpy(&word_a, a + i, 8);
+            std::memcpy(&word_b, b + i, 8);
+            std::memcpy(&word_c, c + i, 8);
+            crc_a = __builtin_ia32_crc32di(crc_a, word_a);
+            crc_b = __builtin_ia32_crc32di(crc_b, word_b);
+            crc_c = __builtin_ia32_crc32di(crc_c, word_c);
+        }
+        uint32_t tail = hardware(static_cast<uint32_t>(crc_c), c + third, length - 3 * third);
+        // combine() works on finalized CRCs
+        uint32_t joined = combine(~static_cast<uint32_t>(crc_a), ~static_cast<uint32_t>(crc_b), third);
+        joined = combine(joined, ~tail, length - 2 * third);
+        return ~joined;
+    }
+#endif
+
+    // GF(2) matrix helpers for combine(), after zlib's crc32_combine
+    static uint32_t matrixTimes(const uint32_t* matrix, uint32_t vector) {
+        uint32_t sum = 0;
+        while (vector) {
+            if (vector & 1) {
+                sum ^= *matrix;
+            }
+            vector >>= 1;
+            ++matrix;
+        }
+        return sum;
+    }
+
+    static void matrixSquare(uint32_t* square, const uint32_t* matrix) {
+        for (int n = 0; n < 32; ++n) {
+            square[n] = matrixTimes(matrix, matrix[n]);
+        }
+    }
+
+    // Operators that append 2^k zero bytes to a CRC, 32 words each, for k = 0..63.
+    // Built once, so combine() is a matrix-vector product per set bit of the length
+    static const uint32_t* zeroOperators() {
+        static const std::vector<uint32_t> operators = []() {
+            std::vector<uint32_t> ops(64 * 32);
+            uint32_t odd[32];
+            uint32_t even[32];
+            odd[0] = polynomial;  // Operator for one zero bit
+            uint32_t row = 1;
+            for (int n = 1; n < 32; ++n) {
+                odd[n] = row;
+                row <<= 1;
+            }
+            matrixSquare(even, odd);          // Two zero bits
+            matrixSquare(odd, even);          // Four zero bits
+            matrixSquare(ops.data(), odd);    // One zero byte
+            for (int k = 1; k < 64; ++k) {
+                matrixSquare(ops.data() + k * 32, ops.data() + (k - 1) * 32);
+            }
+            return ops;
+        }();
+        return operators.data();
+    }
+
+public:
+    static bool accelerated() {
+#if defined(__x86_64__)
+        static bool sse42 = __builtin_cpu_supports("sse4.2");
+        return sse42;
+#else
+        return false;
+#endif
+    }
+
+    // CRC of the bytes covered by crc followed by data[0, length)
+    static uint32_t extend(uint32_t crc, const char* data, size_t length) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+#if defined(__x86_64__)
+        if (accelerated()) {
+            // Below this the cost of joining the streams outweighs the overlap
+            const size_t interleave_min = 64 * 1024;
+            return ~(length >= interleave_min ? hardware3(~crc, bytes, length) : hardware(~crc, bytes, length));
+        }
+#endif
+        return ~software(~crc, bytes, length);
+    }
+
+    // CRC of A followed by B, from crc(A), crc(B) and B's length
+    static uint32_t combine(uint32_t crc1, uint32_t crc2, size_t length2) {
+        if (length2 == 0) {
+            return crc1;
+        }
+        // Zero bytes leave a zero CRC at zero, so joining onto nothing is just crc2
+        if (crc1 == 0) {
+            return crc2;
+        }
+        // Apply length2 zero bytes to crc1, one precomputed operator per set bit
+        const uint32_t* operators = zeroOperators();
+        for (; length2 != 0; length2 >>= 1, operators += 32) {
+            if (length2 & 1) {
+                crc1 = matrixTimes(operators, crc1);
+            }
+        }
+        return crc1 ^ crc2;
+    }
+};
+
+// preadv until every iovec is filled or EOF, resuming after short reads and EINTR.
+// Linux returns at most about 2 GiB per call, so large requests take several calls.
+// direct_block is the O_DIRECT block size of fd (0 if buffered): a direct read that
+// stops mid-block has reached EOF
+ssize_t preadvFull(int fd, iovec* iov, int iov_count, size_t offset, size_t direct_block) {
+    size_t total = 0;
+    while (iov_count > 0) {
+        ssize_t n = ::preadv(fd, iov, iov_count, offset + total);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += n;
+        if (direct_block > 0 && n % direct_block != 0) {
+            break;
+        }
+        // Skip the iovecs that are now full and trim the partially filled one
+        size_t consumed = n;
+        while (iov_count > 0 && consumed >= iov->iov_len) {
+            consumed -= iov->iov_len;
+            ++iov;
+            --iov_count;
+        }
+        if (iov_count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + consumed;
+            iov->iov_len -= consumed;
+        }
+    }
+    return static_cast<ssize_t>(total);
+}
+
+ssize_t preadFull(int fd, char* dest, size_t size, size_t offset, size_t direct_block) {
+    iovec iov;
+    iov.iov_base = dest;
+    iov.iov_len = size;
+    return preadvFull(fd, &iov, 1, offset, direct_block);
+}
+
+// O_DIRECT read of [offset, offset + length) when offset, length or dest is not
+// block aligned: read the whole blocks covering it into the aligned bounce buffer,
+// which must hold them, and copy just those bytes to dest. Returns the bytes
+// copied, short at EOF, or -1 with errno set
+ssize_t preadBounced(int fd, char* bounce, size_t block_size, char* dest, size_t length, size_t offset) {
+    size_t aligned_offset = (offset / block_size) * block_size;
+    size_t offset_in_block = offset - aligned_offset;
+    size_t request = ((offset_in_block + length + block_size - 1) / block_size) * block_size;
+    ssize_t actually_read = preadFull(fd, bounce, request, aligned_offset, block_size);
+    if (actually_read == -1) {
+        return -1;
+    }
+    if (static_cast<size_t>(actually_read) <= offset_in_block) {
+        return 0;
+    }
+    size_t copied = std::min(static_cast<size_t>(actually_read) - offset_in_block, length);
+    std::memcpy(dest, bounce + offset_in_block, copied);
+    return static_cast<ssize_t>(copied);
+}
+
+// Size of the file at path, or of the device for a block special file; 0 if it
+// cannot be determined
+size_t fileSize(const std::string& path) {
+    struct stat stat_buf;
+    int rc = stat(path.c_str(), &stat_buf);
+    if (rc == 0 && S_ISBLK(stat_buf.st_mode)) {
+        // Block devices report st_size 0; ask the device instead
+        uint64_t device_size = 0;
+        int device_fd = open(path.c_str(), O_RDONLY);
+        if (device_fd != -1) {
+            if (ioctl(device_fd, BLKGETSIZE64, &device_size) != 0) {
+                device_size = 0;
+            }
+            close(device_fd);
+        }
+        return device_size;
+    }
+    return rc == 0 ? stat_buf.st_size : 0;
+}
+
+// sysfs queue directory of the block device holding path (the device itself for a
+// block special file), with a trailing slash; empty without one
+std::string deviceQueuePath(const std::string& path) {
+    struct stat stat_buf;
+    if (stat(path.c_str(), &stat_buf) != 0) {
+        return "";
+    }
+    dev_t device = S_ISBLK(stat_buf.st_mode) ? stat_buf.st_rdev : stat_buf.st_dev;
+    std::string sys_path = "/sys/dev/block/" + std::to_string(major(device)) + ":" + std::to_string(minor(device));
+    if (access(sys_path.c_str(), F_OK) != 0) {
+        return "";
+    }
+    // Partitions have no queue directory of their own; their parent disk does
+    std::string queue = sys_path + "/queue/";
+    if (access(queue.c_str(), F_OK) != 0) {
+        queue = sys_path + "/../queue/";
+    }
+    return queue;
+}
+
+// Alignment O_DIRECT needs for path: statx STATX_DIOALIGN (Linux 6.1+), else
+// BLKSSZGET for a block device, else the device's logical block size from sysfs,
+// else 4096. Reads land in memory at their file offset, so one value must satisfy
+// both the offset and the memory alignment: the larger of the two, rounded up to
+// the power of two posix_memalign needs. source names where the value came from
+size_t directAlignment(const std::string& path, std::string* source = nullptr) {
+    std::string from;
+    size_t alignment = 0;
+    struct statx stx;
+    std::memset(&stx, 0, sizeof(stx));
+    if (statx(AT_FDCWD, path.c_str(), 0, STATX_DIOALIGN | STATX_TYPE, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN)) {
+        if (stx.stx_dio_offset_align == 0) {
+            std::cerr << "Warning: " << path << " reports no O_DIRECT support\n";
+        } else {
+            alignment = std::max(stx.stx_dio_offset_align, stx.stx_dio_mem_align);
+            from = "statx";
+        }
+    }
+    if (alignment == 0 && S_ISBLK(stx.stx_mode)) {
+        int probe_fd = open(path.c_str(), O_RDONLY);
+        int sector_size = 0;
+        if (probe_fd != -1 && ioctl(probe_fd, BLKSSZGET, &sector_size) == 0 && sector_size > 0) {
+            alignment = static_cast<size_t>(sector_size);
+            from = "BLKSSZGET";
+        }
+        if (probe_fd != -1) {
+            close(probe_fd);
+        }
+    }
+    if (alignment == 0) {
+        std::string queue = deviceQueuePath(path);
+        if (!queue.empty() && std::ifstream(queue + "logical_block_size") >> alignment && alignment > 0) {
+            from = "logical_block_size";
+        }
+    }
+    if (alignment == 0) {
+        alignment = 4096;
+        from = "default";
+    }
+    size_t block = sizeof(void*);
+    while (block < alignment) {
+        block *= 2;
+    }
+    if (source) {
+        *source = from;
+    }
+    return block;
+}
 
 class ParallelFileReader {
 private:
@@ -16,356 +899,3326 @@ private:
     char* buffer;
     size_t num_threads;
     size_t read_chunk_size;  // Size of each read operation (e.g., 1MB)
-    size_t block_size = 4096;  // Filesystem block size for O_DIRECT alignment
+    size_t block_size = 4096;  // O_DIRECT offset, length and buffer alignment; queried from the file
     bool use_odirect;  // Whether to use O_DIRECT for file I/O
+    IoEngine io_engine = IoEngine::Sync;  // How each thread issues its reads
+    unsigned queue_depth = 32;  // Reads kept in flight per thread with io_uring
+    size_t chunks_per_syscall = 1;  // Chunks filled by each preadv on the sync path
+    int fd = -1;  // Descriptor shared by all reader threads for the duration of read()
+    Scheduler scheduler = Scheduler::Static;
+    std::atomic<size_t> next_chunk_offset{0};  // Dynamic scheduler: next unclaimed file offset
+    std::shared_ptr<ThreadPool> pool;  // Workers for the memset and read phases, kept across read() calls
+    BufferInit buffer_init = BufferInit::Memset;
+    NumaPolicy numa_policy = NumaPolicy::None;
+    ThreadPinning pinning = ThreadPinning::None;
+    std::unique_ptr<NumaTopology> topology;  // Loaded when placement or pinning is requested
+    HugePages huge_pages = HugePages::None;
+    CacheAdvice cache_advice = CacheAdvice::None;
+    size_t readahead_window = 0;  // Buffered reads: keep readahead() this far ahead of each thread
+    bool drop_behind = false;     // Buffered reads: POSIX_FADV_DONTNEED once bytes are in buffer
+    static constexpr size_t drop_span = 2UL << 20;  // Largest page cache folio drop-behind has to catch
+    std::unique_ptr<std::atomic<size_t>[]> drop_consumed;  // Bytes consumed so far in each drop_span of the file
+    size_t buffer_mapping_size = 0;  // Length of the hugetlb mapping behind buffer, if any
+    bool buffer_malloced = false;    // buffer came from posix_memalign rather than new[]
+    std::function<void(size_t, size_t)> range_done;  // Told of each range of buffer once it holds file data
+    std::shared_ptr<ThreadPool> consumer_pool;        // process() consumer threads, kept across calls
+    std::thread async_thread;  // Runs read() for read_async()
+    bool auto_tune = false;  // Pick read_chunk_size (and queue_depth) on the first read()
+    bool tuned = false;
+    bool probing = false;    // A tuning trial is running: keep per-thread reports quiet
+    bool cache_aware = false;  // Read uncached ranges first and copy cached ones with buffered reads
+    int cached_fd = -1;        // Buffered descriptor for cached ranges and hybrid edges when fd is O_DIRECT
+    bool hybrid_direct = false;  // O_DIRECT for whole blocks only; unaligned edges are read buffered
+    size_t direct_min_file = 0;  // Hybrid mode: smaller files are read entirely buffered
+
+    // Cache-aware reads: the file split into ranges, uncached ones first
+    struct ReadRange {
+        size_t offset;
+        size_t length;
+        bool cached;
+    };
+    std::vector<ReadRange> read_plan;
+    std::atomic<size_t> next_range{0};
+
+    // Inline checksums: CRC32C of each range as it is read, joined per chunk and per file
+    struct ChecksumPiece {
+        size_t offset;
+        size_t length;
+        uint32_t crc;
+    };
+    bool checksum = false;
+    std::mutex checksum_mutex;
+    std::atomic<uint64_t> hash_nanoseconds{0};   // Thread time spent hashing
+    size_t digest_block = 0;                     // Requested digest grid; 0: read_chunk_size
+    size_t checksum_chunk = 0;                   // Chunk grid of chunk_checksums, fixed for a whole read
+    // Chunks still being read: index -> (bytes hashed so far, their pieces)
+    std::map<size_t, std::pair<size_t, std::vector<ChecksumPiece>>> open_chunks;
+    size_t chunks_completed = 0;
+    std::vector<uint32_t> chunk_checksums;       // One per checksum_chunk bytes of the file
+    uint32_t file_checksum = 0;
+    bool checksum_complete = false;
+    std::vector<uint32_t> manifest;              // Expected digest per block, from setManifest()
+    std::vector<size_t> failed_chunks;           // Blocks whose digest did not match the manifest
+    bool manifest_final_pass = true;             // No re-read follows: pass on blocks even if they fail
+
+    // One read_chunk_size unit of a section tracked while its read is in flight
+    struct UringRead {
+        size_t file_offset;  // Where this unit starts in the file (block aligned for O_DIRECT)
+        size_t length;       // Bytes requested for this unit
+        size_t done;         // Bytes already returned by the kernel
+        char* dest;          // Destination: main buffer, or an aligned slab for O_DIRECT
+        bool bounced;        // Read into a slab and copied out (unaligned O_DIRECT edges)
+        unsigned buf_index;  // Registered buffer that dest lies in
+    };
+
+    // Largest buffer the kernel accepts in a single io_uring buffer registration
+    static constexpr size_t max_registered_buffer = 1UL << 30;
+
+    // Largest transfer Linux performs in one read (MAX_RW_COUNT)
+    static constexpr size_t max_read_size = 0x7ffff000;
+
+    // Dynamic scheduler: claim the next chunk of the file, or return false when none are left
+    bool claimChunk(size_t claim_size, size_t& offset, size_t& length) {
+        offset = next_chunk_offset.fetch_add(claim_size, std::memory_order_relaxed);
+        if (offset >= file_size) {
+            return false;
+        }
+        length = std::min(claim_size, file_size - offset);
+        return true;
+    }
+
+    // Called by reader threads as soon as [offset, offset + length) of buffer is final
+    void rangeRead(size_t offset, size_t length) {
+        hashRange(offset, buffer + offset, length);
+        // With a manifest, hashRange() passes on whole blocks once they have been checked
+        if (range_done && length > 0 && manifest.empty()) {
+            range_done(offset, length);
+        }
+    }
+
+    // Checksum a range while it is still in cache. Ranges are cut at chunk boundaries
+    // so per-chunk digests come out the same whatever the threads and engine. Once all
+    // of a chunk has been hashed its digest is joined and, with a manifest, checked.
+    // A checked block goes to range_done once it matches, or failed its last re-read
+    void hashRange(size_t offset, const char* data, size_t length) {
+        if (!checksum || length == 0) {
+            return;
+        }
+        auto hash_start = std::chrono::high_resolution_clock::now();
+        std::vector<ChecksumPiece> pieces;
+        size_t end = offset + length;
+        for (size_t piece_start = offset; piece_start < end;) {
+            size_t piece_end = std::min(end, (piece_start / checksum_chunk + 1) * checksum_chunk);
+            pieces.push_back(ChecksumPiece{piece_start, piece_end - piece_start,
+                                           Crc32c::extend(0, data + (piece_start - offset), piece_end - piece_start)});
+            piece_start = piece_end;
+        }
+
+        std::vector<std::pair<size_t, std::vector<ChecksumPiece>>> completed;
+        {
+            std::lock_guard<std::mutex> lock(checksum_mutex);
+            for (const auto& piece : pieces) {
+                size_t index = piece.offset / checksum_chunk;
+                auto& chunk = open_chunks[index];
+                chunk.first += piece.length;
+                chunk.second.push_back(piece);
+                if (chunk.first == std::min(checksum_chunk, file_size - index * checksum_chunk)) {
+                    completed.emplace_back(index, std::move(chunk.second));
+                    open_chunks.erase(index);
+                }
+            }
+        }
+
+        // Join completed chunks outside the lock; combine() costs a few matrix products per piece
+        for (auto& chunk : completed) {
+            std::sort(chunk.second.begin(), chunk.second.end(),
+                      [](const ChecksumPiece& a, const ChecksumPiece& b) { return a.offset < b.offset; });
+            uint32_t crc = 0;
+            for (const auto& piece : chunk.second) {
+                crc = Crc32c::combine(crc, piece.crc, piece.length);
+            }
+            bool matches = manifest.empty() || crc == manifest[chunk.first];
+            {
+                std::lock_guard<std::mutex> lock(checksum_mutex);
+                chunk_checksums[chunk.first] = crc;
+                ++chunks_completed;
+                if (!matches) {
+                    failed_chunks.push_back(chunk.first);
+                    char digests[64];
+                    snprintf(digests, sizeof(digests), "%08x, manifest has %08x", crc, manifest[chunk.first]);
+                    std::cerr << "Block " << chunk.first << " at offset " << chunk.first * checksum_chunk
+                              << ": CRC32C " << digests << "\n";
+                }
+            }
+            if (!manifest.empty() && range_done && (matches || manifest_final_pass)) {
+                size_t block_offset = chunk.first * checksum_chunk;
+                range_done(block_offset, std::min(checksum_chunk, file_size - block_offset));
+            }
+        }
+
+        auto hash_end = std::chrono::high_resolution_clock::now();
+        hash_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(hash_end - hash_start).count();
+    }
+
+    // Join the chunk digests of the last read into the file checksum
+    void finishChecksums() {
+        checksum_complete = chunks_completed == chunk_checksums.size();
+        file_checksum = 0;
+        for (size_t i = 0; i < chunk_checksums.size(); ++i) {
+            size_t length = std::min(checksum_chunk, file_size - i * checksum_chunk);
+            file_checksum = Crc32c::combine(file_checksum, chunk_checksums[i], length);
+        }
+    }
+
+    void resetChecksums() {
+        checksum_chunk = digest_block > 0 ? digest_block : read_chunk_size;
+        open_chunks.clear();
+        chunk_checksums.assign((file_size + checksum_chunk - 1) / checksum_chunk, 0);
+        chunks_completed = 0;
+        failed_chunks.clear();
+        hash_nanoseconds = 0;
+    }
+
+    // Re-read blocks that failed the manifest check, straight from the device where
+    // possible, in case the corruption happened in transit or in the page cache
+    void rereadFailedBlocks() {
+        const int max_attempts = 2;
+        for (int attempt = 1; attempt <= max_attempts && !failed_chunks.empty(); ++attempt) {
+            std::vector<size_t> blocks;
+            blocks.swap(failed_chunks);
+            std::cout << "Re-reading " << blocks.size() << " block(s) that failed the manifest (attempt "
+                      << attempt << " of " << max_attempts << ")\n";
+            chunks_completed -= blocks.size();
+            manifest_final_pass = attempt == max_attempts;
+            pool->run(blocks.size(), [&](size_t i) {
+                size_t offset = blocks[i] * checksum_chunk;
+                size_t length = std::min(checksum_chunk, file_size - offset);
+                if (!use_odirect) {
+                    posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+                }
+                readSection(i, offset, length);
+            });
+        }
+    }
+
+    void reportChecksums(double read_seconds) {
+        double hash_seconds = hash_nanoseconds / 1e9;
+        char digest[16];
+        snprintf(digest, sizeof(digest), "%08x", file_checksum);
+        std::cout << "CRC32C: " << digest << (checksum_complete ? "" : " (incomplete: some bytes were not read)")
+                  << " over " << chunk_checksums.size() << " chunk digests ("
+                  << (Crc32c::accelerated() ? "SSE4.2" : "software") << ")\n";
+        if (!manifest.empty()) {
+            std::cout << "Manifest: " << chunks_completed - failed_chunks.size() << " of " << manifest.size()
+                      << " blocks match";
+            for (size_t index : failed_chunks) {
+                size_t offset = index * checksum_chunk;
+                std::cout << (index == failed_chunks.front() ? "; corrupt: [" : ", [") << offset << ", "
+                          << std::min(offset + checksum_chunk, file_size) << ")";
+            }
+            std::cout << "\n";
+        }
+        std::cout << "Hashing: " << (hash_seconds > 0 ? (file_size / (1024.0 * 1024.0)) / hash_seconds : 0)
+                  << " MB/s per thread, " << static_cast<long>(hash_seconds * 1000) << " ms of thread time ("
+                  << (read_seconds > 0 ? 100.0 * hash_seconds / (read_seconds * num_threads) : 0)
+                  << "% of the read's thread time)\n";
+    }
+
+    // Buffered reads: keep readahead() issued readahead_window bytes past offset (but
+    // not past limit), topping up half a window at a time; issued_end tracks progress
+    void readAhead(size_t& issued_end, size_t offset, size_t limit) {
+        if (readahead_window == 0 || use_odirect) {
+            return;
+        }
+        size_t target = std::min(offset + readahead_window, limit);
+        if (target <= issued_end || (target < limit && target - issued_end < readahead_window / 2)) {
+            return;
+        }
+        size_t from = std::max(issued_end, offset);
+        ::readahead(fd, from, target - from);
+        issued_end = target;
+    }
+
+    // Buffered reads: WILLNEED for a whole section before reading it
+    void adviseSection(size_t offset, size_t length) {
+        if (cache_advice == CacheAdvice::WillNeed && !use_odirect) {
+            posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+        }
+    }
+
+    // Drop-behind: these bytes are in buffer now, so their page cache pages can go.
+    // The kernel skips large folios that stick out of the range, so the 2 MB spans
+    // at either end are counted instead and dropped whole once every byte of them
+    // has been consumed, by whichever threads read them. Widening a range by itself
+    // could evict pages another thread prefetched and has not read yet
+    void dropBehind(size_t offset, size_t length) {
+        if (!drop_behind || use_odirect || length == 0) {
+            return;
+        }
+        size_t end = offset + length;
+        posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+        size_t first = offset / drop_span;
+        size_t last = (end - 1) / drop_span;
+        for (size_t span : {first, last}) {
+            size_t span_start = span * drop_span;
+            size_t span_end = std::min(span_start + drop_span, file_size);
+            size_t consumed = std::min(end, span_end) - std::max(offset, span_start);
+            if (span_start >= offset && span_end <= end) {
+                continue;  // Wholly inside this range: already dropped
+            }
+            if (drop_consumed[span].fetch_add(consumed) + consumed == span_end - span_start) {
+                posix_fadvise(fd, span_start, span_end - span_start, POSIX_FADV_DONTNEED);
+            }
+            if (first == last) {
+                break;
+            }
+        }
+    }
+
+    void resetDropBehind() {
+        if (drop_behind && !use_odirect) {
+            drop_consumed.reset(new std::atomic<size_t>[(file_size + drop_span - 1) / drop_span]());
+        }
+    }
+
+    // First block boundary at or after offset, and last one at or before it
+    size_t wholeBlocksStart(size_t offset) const {
+        return ((offset + block_size - 1) / block_size) * block_size;
+    }
+
+    size_t wholeBlocksEnd(size_t offset) const {
+        return (offset / block_size) * block_size;
+    }
+
+    // A thread's io_uring instance with its registrations and edge bounce slabs,
+    // set up once and reused for every range the thread reads through it
+    struct UringContext {
+        std::unique_ptr<IoUring> ring;
+        int file_ref = -1;          // fd, or its index in the registered file table
+        bool fixed_file = false;
+        bool fixed_buffers = false;
+        size_t registered_start = 0;  // buffer offsets covered by the registered pieces
+        size_t registered_end = 0;
+        size_t piece_size = 0;
+        // Bounce slabs for unaligned O_DIRECT edges, allocated when the first one is
+        // needed. Edge reads are at most two blocks (a section with no whole block
+        // inside), so a thread needs one or two slabs and most need none
+        std::vector<char*> slabs;
+        std::vector<char*> free_slabs;
+
+        ~UringContext() {
+            for (char* slab : slabs) {
+                free(slab);
+            }
+        }
+    };
+
+    // Create the ring and register fd
+    bool setupUring(size_t thread_id, UringContext& ctx) {
+        try {
+            ctx.ring.reset(new IoUring(queue_depth));
+        } catch (const std::exception& e) {
+            std::cerr << "Thread " << thread_id << ": " << e.what() << "\n";
+            return false;
+        }
+
+        // Register the descriptor so the kernel skips the fd table lookup and refcount per I/O
+        ctx.file_ref = fd;
+        ctx.fixed_file = ctx.ring->registerFiles(&fd, 1) == 0;
+        if (ctx.fixed_file) {
+            ctx.file_ref = 0;
+        }
+        return true;
+    }
+
+    // For O_DIRECT, register [registered_start, registered_end) of buffer, the whole
+    // blocks the thread is about to read in place, in place of any earlier range. Their
+    // pages are then pinned once instead of on every read, in pieces of at most 1 GiB
+    // that hold whole chunks. The few edge reads through slabs stay unregistered.
+    // Only the reading thread registers its own range, so first-touch placement holds
+    // and pinned memory stays at the file size across all threads
+    void registerUring(size_t thread_id, UringContext& ctx, size_t registered_start, size_t registered_end) {
+        if (!ctx.ring) {
+            return;
+        }
+        if (ctx.fixed_buffers) {
+            ctx.ring->unregisterBuffers();
+            ctx.fixed_buffers = false;
+        }
+        ctx.piece_size = (max_registered_buffer / read_chunk_size) * read_chunk_size;
+        if (use_odirect && ctx.piece_size > 0 && registered_end > registered_start) {
+            std::vector<iovec> pieces;
+            for (size_t offset = registered_start; offset < registered_end; offset += ctx.piece_size) {
+                iovec piece;
+                piece.iov_base = buffer + offset;
+                piece.iov_len = std::min(ctx.piece_size, registered_end - offset);
+                pieces.push_back(piece);
+            }
+            int rc = ctx.ring->registerBuffers(pieces.data(), static_cast<unsigned>(pieces.size()));
+            if (rc != 0) {
+                // Pinning the interior may exceed RLIMIT_MEMLOCK
+                std::cerr << "Thread " << thread_id << ": Could not register fixed buffers ("
+                          << strerror(-rc) << "), using unregistered reads\n";
+            }
+            ctx.fixed_buffers = rc == 0;
+            ctx.registered_start = registered_start;
+            ctx.registered_end = registered_end;
+        }
+    }
+
+    // io_uring path for one section on a ring of its own. The dynamic scheduler's
+    // section is the whole file, but a thread only learns its chunks as it claims them:
+    // registering per claim pins a chunk per call just like an unregistered read does,
+    // so those threads read without fixed buffers
+    size_t readSectionUring(size_t thread_id, size_t section_start, size_t section_size) {
+        UringContext ctx;
+        if (!setupUring(thread_id, ctx)) {
+            return 0;
+        }
+        if (scheduler == Scheduler::Static) {
+            registerUring(thread_id, ctx, wholeBlocksStart(section_start),
+                          wholeBlocksEnd(section_start + section_size));
+        }
+        return readRangeUring(thread_id, ctx, section_start, section_size);
+    }
+
+    // io_uring path: keep up to queue_depth chunk reads of the section in flight at once.
+    // With the dynamic scheduler the section is the whole file and chunks are claimed
+    // from the shared cursor as slots free up
+    size_t readRangeUring(size_t thread_id, UringContext& ctx, size_t section_start, size_t section_size) {
+        if (!ctx.ring) {
+            return 0;
+        }
+        size_t section_end = section_start + section_size;
+
+        // O_DIRECT reads whole blocks, so widen the section to block boundaries. The
+        // whole blocks inside the section go straight into buffer; only the
+        // unaligned head and tail blocks are read into a slab and copied
+        size_t read_start = section_start;
+        size_t read_end = section_end;
+        size_t interior_start = section_start;
+        size_t interior_end = section_end;
+        if (use_odirect) {
+            read_start = (section_start / block_size) * block_size;
+            read_end = ((section_end + block_size - 1) / block_size) * block_size;
+            interior_start = ((section_start + block_size - 1) / block_size) * block_size;
+            interior_end = (section_end / block_size) * block_size;
+            if (hybrid_direct && scheduler == Scheduler::Static) {
+                // Hybrid: the ring reads only whole blocks; the edges are read buffered below
+                if (interior_start >= interior_end) {
+                    interior_start = interior_end = section_end;
+                }
+                read_start = interior_start;
+                read_end = interior_end;
+            } else if (interior_start >= interior_end) {
+                interior_start = interior_end = read_start;
+            }
+        }
+
+        IoUring* ring = ctx.ring.get();
+        unsigned depth = ring->size();
+        std::vector<UringRead> slots(depth);
+        const size_t slab_size = 2 * block_size;
+
+        std::vector<unsigned> free_slots;
+        for (unsigned i = depth; i > 0; --i) {
+            free_slots.push_back(i - 1);
+        }
+
+        size_t next_offset = read_start;
+        size_t pending_tail = SIZE_MAX;  // Dynamic: the file's partial last block, read after its chunk
+        size_t bytes_completed = 0;
+        size_t readahead_end = read_start;
+        if (scheduler == Scheduler::Static) {
+            adviseSection(section_start, section_size);
+        }
+        if (use_odirect && hybrid_direct && scheduler == Scheduler::Static) {
+            bytes_completed += readCached(thread_id, section_start, interior_start - section_start);
+            bytes_completed += readCached(thread_id, interior_end, section_end - interior_end);
+        }
+        unsigned in_flight = 0;
+        bool failed = false;
+
+        auto queueRead = [&](unsigned slot) {
+            UringRead& r = slots[slot];
+            io_uring_sqe* sqe = ring->getSqe();
+            // Longer units are finished by the short-read resubmission below
+            size_t max_length = (max_read_size / block_size) * block_size;
+            unsigned length = static_cast<unsigned>(std::min(r.length - r.done, max_length));
+            // Registered only if the unit lies within one registered piece
+            bool fixed = ctx.fixed_buffers && !r.bounced && r.file_offset >= ctx.registered_start
+                         && r.file_offset + r.length <= ctx.registered_end
+                         && (r.file_offset - ctx.registered_start) / ctx.piece_size
+                                == (r.file_offset + r.length - 1 - ctx.registered_start) / ctx.piece_size;
+            if (fixed) {
+                ring->prepReadFixed(sqe, ctx.file_ref, r.dest + r.done, length, r.file_offset + r.done,
+                                    r.buf_index, slot);
+            } else {
+                ring->prepRead(sqe, ctx.file_ref, r.dest + r.done, length, r.file_offset + r.done, slot);
+            }
+            if (ctx.fixed_file) {
+                sqe->flags |= IOSQE_FIXED_FILE;
+            }
+            ++in_flight;
+        };
+
+        while (true) {
+            // Top up the ring with new chunks while there are free slots
+            while (!failed && !free_slots.empty()) {
+                unsigned slot = free_slots.back();
+                UringRead& r = slots[slot];
+                if (scheduler == Scheduler::Dynamic && pending_tail != SIZE_MAX) {
+                    r.file_offset = pending_tail;
+                    r.length = block_size;
+                    r.bounced = true;
+                    pending_tail = SIZE_MAX;
+                } else if (scheduler == Scheduler::Dynamic) {
+                    // Claimed chunks start on chunk (hence block) boundaries; under O_DIRECT
+                    // only the partial block ending the file's last chunk needs a slab
+                    size_t length;
+                    if (!claimChunk(read_chunk_size, r.file_offset, length)) {
+                        break;
+                    }
+                    size_t end = r.file_offset + length;
+                    bool unaligned = use_odirect && end % block_size != 0;
+                    if (unaligned && hybrid_direct) {
+                        bytes_completed += readCached(thread_id, r.file_offset, length);
+                        continue;
+                    }
+                    size_t whole_end = unaligned ? (end / block_size) * block_size : end;
+                    if (unaligned) {
+                        pending_tail = whole_end;
+                    }
+                    if (whole_end > r.file_offset) {
+                        r.length = whole_end - r.file_offset;
+                        r.bounced = false;
+                    } else {
+                        r.length = block_size;
+                        r.bounced = true;
+                        pending_tail = SIZE_MAX;
+                    }
+                } else if (next_offset >= read_end) {
+                    break;
+                } else if (next_offset < interior_start) {
+                    r.file_offset = next_offset;
+                    r.length = interior_start - next_offset;
+                    r.bounced = true;
+                } else if (next_offset < interior_end) {
+                    r.file_offset = next_offset;
+                    r.length = std::min(read_chunk_size, interior_end - next_offset);
+                    r.bounced = false;
+                } else {
+                    r.file_offset = next_offset;
+                    r.length = std::min(read_chunk_size, read_end - next_offset);
+                    r.bounced = use_odirect;
+                }
+                if (r.bounced && ctx.free_slabs.empty()) {
+                    char* slab = nullptr;
+                    auto temp_alloc_start = std::chrono::high_resolution_clock::now();
+                    if (posix_memalign(reinterpret_cast<void**>(&slab), block_size, slab_size) != 0) {
+                        std::cerr << "Thread " << thread_id << ": Failed to allocate aligned temp buffer\n";
+                        failed = true;
+                        break;
+                    }
+                    auto temp_alloc_end = std::chrono::high_resolution_clock::now();
+                    auto temp_alloc_duration = std::chrono::duration_cast<std::chrono::microseconds>(temp_alloc_end - temp_alloc_start);
+                    std::cout << "Thread " << thread_id << " temp buffer allocation: " << temp_alloc_duration.count() << " μs\n";
+                    ctx.slabs.push_back(slab);
+                    ctx.free_slabs.push_back(slab);
+                }
+                free_slots.pop_back();
+                r.done = 0;
+                if (r.bounced) {
+                    r.dest = ctx.free_slabs.back();
+                    ctx.free_slabs.pop_back();
+                    r.buf_index = 0;
+                } else {
+                    r.dest = buffer + r.file_offset;
+                    r.buf_index = ctx.fixed_buffers
+                        ? static_cast<unsigned>((r.file_offset - ctx.registered_start) / ctx.piece_size) : 0;
+                }
+                if (scheduler == Scheduler::Static) {
+                    readAhead(readahead_end, r.file_offset, read_end);
+                    next_offset += r.length;
+                }
+                queueRead(slot);
+            }
+
+            if (in_flight == 0) {
+                break;
+            }
+
+            int rc = ring->submit(1);
+            if (rc < 0) {
+                std::cerr << "Thread " << thread_id << ": io_uring_enter failed: " << strerror(-rc) << "\n";
+                ctx.ring.reset();  // Reads may still be in flight: this ring cannot be reused
+                break;
+            }
+
+            io_uring_cqe* cqe;
+            while ((cqe = ring->peekCqe()) != nullptr) {
+                unsigned slot = static_cast<unsigned>(cqe->user_data);
+                int res = cqe->res;
+                ring->cqeSeen();
+                --in_flight;
+
+                UringRead& r = slots[slot];
+                if (res == -EINTR || res == -EAGAIN) {
+                    queueRead(slot);
+                    continue;
+                }
+                if (res < 0) {
+                    std::cerr << "Thread " << thread_id << ": Read error at offset "
+                              << r.file_offset + r.done << ": " << strerror(-res) << "\n";
+                    failed = true;
+                    if (r.bounced) {
+                        ctx.free_slabs.push_back(r.dest);
+                    }
+                    free_slots.push_back(slot);
+                    continue;
+                }
+
+                r.done += res;
+                // A short read that is not at EOF just continues where it stopped;
+                // for O_DIRECT a partial block means the file ended
+                bool at_eof = res == 0 || (use_odirect && r.done % block_size != 0);
+                if (r.done < r.length && !at_eof) {
+                    queueRead(slot);
+                    continue;
+                }
+
+                if (r.bounced) {
+                    // Copy only the part of the unit that belongs to this section
+                    size_t copy_start = std::max(r.file_offset, section_start);
+                    size_t copy_end = std::min(r.file_offset + r.done, section_end);
+                    if (copy_end > copy_start) {
+                        std::memcpy(buffer + copy_start, r.dest + (copy_start - r.file_offset), copy_end - copy_start);
+                        bytes_completed += copy_end - copy_start;
+                        rangeRead(copy_start, copy_end - copy_start);
+                    }
+                    ctx.free_slabs.push_back(r.dest);
+                } else {
+                    bytes_completed += r.done;
+                    rangeRead(r.file_offset, r.done);
+                    dropBehind(r.file_offset, r.done);
+                }
+                free_slots.push_back(slot);
+            }
+        }
+
+        return bytes_completed;
+    }
+
+    ssize_t preadvFull(iovec* iov, int iov_count, size_t offset) {
+        return ::preadvFull(fd, iov, iov_count, offset, use_odirect ? block_size : 0);
+    }
+
+    ssize_t preadFull(char* dest, size_t size, size_t offset) {
+        return ::preadFull(fd, dest, size, offset, use_odirect ? block_size : 0);
+    }
+
+    // O_DIRECT: read [start, start + size) through the aligned temp_buffer of temp_size
+    // bytes (whole blocks) and copy just those bytes into buffer; used for the
+    // unaligned edges of a section
+    size_t readBounced(size_t thread_id, char* temp_buffer, size_t temp_size, size_t start, size_t size) {
+        size_t bytes_processed = 0;
+        size_t current_offset = start;
+
+        while (bytes_processed < size) {
+            // At most a temp buffer's worth of whole blocks per read
+            size_t offset_in_block = current_offset % block_size;
+            size_t bytes_to_copy = std::min(temp_size - offset_in_block, size - bytes_processed);
+            ssize_t copied = preadBounced(fd, temp_buffer, block_size, buffer + current_offset, bytes_to_copy,
+                                          current_offset);
+
+            if (copied == -1) {
+                std::cerr << "Thread " << thread_id << ": Read error at offset "
+                          << current_offset << "\n";
+                break;
+            }
+            if (copied == 0) {
+                break;
+            }
+            rangeRead(current_offset, copied);
+
+            bytes_processed += copied;
+            current_offset += copied;
+
+            // Stop at EOF
+            if (static_cast<size_t>(copied) < bytes_to_copy) {
+                break;
+            }
+        }
+
+        return bytes_processed;
+    }
+
+    // Read [start, start + size) straight into buffer at the same offset, one chunk
+    // per iovec and up to chunks_per_syscall chunks per preadv. For O_DIRECT the
+    // range must be block aligned
+    size_t readInPlace(size_t thread_id, size_t start, size_t size) {
+        size_t bytes_read = 0;
+        size_t current_offset = start;
+        size_t readahead_end = start;
+        std::vector<iovec> iovecs(chunks_per_syscall);
+
+        while (bytes_read < size) {
+            size_t bytes_to_read = 0;
+            int iov_count = 0;
+            while (iov_count < static_cast<int>(chunks_per_syscall) && bytes_read + bytes_to_read < size) {
+                size_t length = std::min(read_chunk_size, size - bytes_read - bytes_to_read);
+                iovecs[iov_count].iov_base = buffer + current_offset + bytes_to_read;
+                iovecs[iov_count].iov_len = length;
+                bytes_to_read += length;
+                ++iov_count;
+            }
+
+            readAhead(readahead_end, current_offset, start + size);
+            ssize_t actually_read = preadvFull(iovecs.data(), iov_count, current_offset);
+
+            if (actually_read == -1) {
+                std::cerr << "Thread " << thread_id << ": Read error at offset "
+                          << current_offset << "\n";
+                break;
+            }
+
+            rangeRead(current_offset, actually_read);
+            dropBehind(current_offset, actually_read);
+            bytes_read += actually_read;
+            current_offset += actually_read;
+
+            // preadvFull only comes back short at EOF, i.e. the file shrank under us
+            if (actually_read < static_cast<ssize_t>(bytes_to_read)) {
+                std::cerr << "Thread " << thread_id << ": Unexpected EOF at offset "
+                          << current_offset << "\n";
+                break;
+            }
+        }
+
+        return bytes_read;
+    }
+
+    // Sync path: read one section of the file into buffer
+    size_t readSection(size_t thread_id, size_t section_start, size_t section_size) {
+        size_t bytes_completed = 0;
+
+        if (use_odirect) {
+            // O_DIRECT path: requires aligned reads. buffer is block aligned, so the
+            // whole blocks of the section are read straight into it and only an
+            // unaligned head and tail go through a temporary aligned buffer
+            size_t section_end = section_start + section_size;
+            size_t interior_start = ((section_start + block_size - 1) / block_size) * block_size;
+            size_t interior_end = (section_end / block_size) * block_size;
+            if (interior_start >= interior_end) {
+                // No whole block inside the section: bounce all of it
+                interior_start = interior_end = section_end;
+            }
+
+            // Hybrid mode reads the edges buffered instead, so needs no temp buffer. Each
+            // edge lies within two blocks (a section with no whole block inside spans at
+            // most two), so that is all the temp buffer holds
+            char* temp_buffer = nullptr;
+            const size_t temp_size = 2 * block_size;
+            if (!hybrid_direct && (interior_start > section_start || section_end > interior_end)) {
+                auto temp_alloc_start = std::chrono::high_resolution_clock::now();
+                if (posix_memalign(reinterpret_cast<void**>(&temp_buffer), block_size, temp_size) != 0) {
+                    std::cerr << "Thread " << thread_id << ": Failed to allocate aligned temp buffer\n";
+                    return 0;
+                }
+                auto temp_alloc_end = std::chrono::high_resolution_clock::now();
+                auto temp_alloc_duration = std::chrono::duration_cast<std::chrono::microseconds>(temp_alloc_end - temp_alloc_start);
+                std::cout << "Thread " << thread_id << " temp buffer allocation: " << temp_alloc_duration.count() << " μs\n";
+            }
+
+            size_t head_size = interior_start - section_start;
+            size_t bytes_processed = hybrid_direct ? readCached(thread_id, section_start, head_size)
+                                                   : readBounced(thread_id, temp_buffer, temp_size, section_start, head_size);
+            if (bytes_processed == head_size) {
+                size_t interior_size = interior_end - interior_start;
+                bytes_processed += readInPlace(thread_id, interior_start, interior_size);
+                if (bytes_processed == head_size + interior_size) {
+                    size_t tail_size = section_end - interior_end;
+                    bytes_processed += hybrid_direct ? readCached(thread_id, interior_end, tail_size)
+                                                     : readBounced(thread_id, temp_buffer, temp_size, interior_end, tail_size);
+                }
+            }
+
+            free(temp_buffer);
+            bytes_completed = bytes_processed;
+        } else {
+            // Regular I/O path: simpler logic
+            adviseSection(section_start, section_size);
+            bytes_completed = readInPlace(thread_id, section_start, section_size);
+        }
+
+        return bytes_completed;
+    }
+
+    // mmap path: fault in [start, start + size) of the file mapping one chunk at a time
+    size_t prefaultRange(size_t thread_id, size_t start, size_t size) {
+        size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t end = start + size;
+        size_t current_offset = start;
+        bool populate = true;
+
+        while (current_offset < end) {
+            size_t chunk_end = std::min(current_offset + read_chunk_size, end);
+            // madvise needs a page aligned start; the mapping itself is page aligned
+            size_t aligned_offset = (current_offset / page_size) * page_size;
+            if (populate && madvise(buffer + aligned_offset, chunk_end - aligned_offset, MADV_POPULATE_READ) != 0) {
+                if (errno != EINVAL) {
+                    std::cerr << "Thread " << thread_id << ": Prefault error at offset "
+                              << current_offset << ": " << strerror(errno) << "\n";
+                    break;
+                }
+                // Kernels before 5.14 lack MADV_POPULATE_READ: start readahead and touch each page
+                populate = false;
+            }
+            if (!populate) {
+                madvise(buffer + aligned_offset, chunk_end - aligned_offset, MADV_WILLNEED);
+                volatile char sink = 0;
+                for (size_t offset = aligned_offset; offset < chunk_end; offset += page_size) {
+                    sink += buffer[offset];
+                }
+                (void)sink;
+            }
+            rangeRead(current_offset, chunk_end - current_offset);
+            current_offset = chunk_end;
+        }
+
+        return current_offset - start;
+    }
+
+    // Map the whole file read-only; the mapping then serves as buffer
+    void mapFile() {
+        int map_fd = open(filename.c_str(), O_RDONLY);
+        if (map_fd == -1) {
+            throw std::runtime_error("Failed to open file: " + filename);
+        }
+        void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, map_fd, 0);
+        close(map_fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Failed to map file: " + std::string(strerror(errno)));
+        }
+        buffer = static_cast<char*>(mapping);
+        buffer_mapping_size = file_size;
+    }
+
+    // One descriptor shared by every thread; all reads are positional
+    void openFile() {
+        int flags = O_RDONLY;
+        if (use_odirect) {
+            flags |= O_DIRECT;
+        }
+        fd = open(filename.c_str(), flags);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open file: " + filename);
+        }
+
+        // Whole-file access pattern hints; WILLNEED is given per section instead
+        const int file_advice[] = {-1, POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM,
+                                   POSIX_FADV_NOREUSE, -1};
+        int advice = file_advice[static_cast<int>(cache_advice)];
+        if (advice != -1 && !use_odirect) {
+            posix_fadvise(fd, 0, 0, advice);
+        }
+    }
+
+    // Wait for an outstanding read_async() before buffer or range_done is reused
+    void finishAsync() {
+        if (async_thread.joinable()) {
+            async_thread.join();
+        }
+    }
+
+    // Streaming mode: pool of chunk slabs shared by the reader threads and the consumer
+    struct StreamState {
+        std::mutex mutex;
+        std::condition_variable slot_free;
+        std::condition_variable chunk_ready;
+        char* slabs = nullptr;
+        std::vector<unsigned> free_slots;
+        std::map<size_t, std::pair<unsigned, size_t>> filled;  // file offset -> (slot, length)
+        size_t readers_done = 0;
+        bool failed = false;
+    };
+
+    // Streaming reader thread: fill free slots with claimed chunks until the file is consumed
+    void streamChunks(size_t thread_id, StreamState& state) {
+        auto thread_start = std::chrono::high_resolution_clock::now();
+        size_t bytes_completed = 0;
+
+        while (true) {
+            unsigned slot;
+            {
+                std::unique_lock<std::mutex> lock(state.mutex);
+                state.slot_free.wait(lock, [&]() { return state.failed || !state.free_slots.empty(); });
+                if (state.failed) {
+                    break;
+                }
+                slot = state.free_slots.back();
+                state.free_slots.pop_back();
+            }
+
+            // Claim only while holding a slot, so the lowest unclaimed chunk can always
+            // be read and an in-order consumer never waits on a chunk nobody can fill
+            size_t offset, length;
+            if (!claimChunk(read_chunk_size, offset, length)) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.free_slots.push_back(slot);
+                break;
+            }
+
+            char* dest = state.slabs + static_cast<size_t>(slot) * read_chunk_size;
+            size_t request = use_odirect ? ((length + block_size - 1) / block_size) * block_size : length;
+            ssize_t actually_read = preadFull(dest, request, offset);
+            bool ok = actually_read >= static_cast<ssize_t>(length);
+            if (ok) {
+                hashRange(offset, dest, length);
+                dropBehind(offset, length);
+            }
+            if (!ok) {
+                std::cerr << "Thread " << thread_id << ": " << (actually_read == -1 ? "Read error" : "Unexpected EOF")
+                          << " at offset " << offset << "\n";
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (ok) {
+                    state.filled[offset] = std::make_pair(slot, length);
+                } else {
+                    state.failed = true;
+                    state.free_slots.push_back(slot);
+                }
+            }
+            state.chunk_ready.notify_one();
+            if (!ok) {
+                state.slot_free.notify_all();
+                break;
+            }
+            bytes_completed += length;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            ++state.readers_done;
+        }
+        state.chunk_ready.notify_one();
+
+        auto thread_end = std::chrono::high_resolution_clock::now();
+        auto thread_duration = std::chrono::duration_cast<std::chrono::milliseconds>(thread_end - thread_start);
+
+        std::cout << "Thread " << thread_id << " completed: processed " << bytes_completed
+                  << " bytes in " << (bytes_completed + read_chunk_size - 1) / read_chunk_size
+                  << " chunks (" << thread_duration.count() << " ms)\n";
+    }
+
+    // Thread worker function to read a portion of the file in configurable chunks.
+    // With the dynamic scheduler the section is ignored and chunks are claimed instead
+    void readChunk(size_t thread_id, size_t section_start, size_t section_size) {
+        auto thread_start = std::chrono::high_resolution_clock::now();
+
+        size_t bytes_completed = 0;
+
+        if (io_engine == IoEngine::Mmap) {
+            if (scheduler == Scheduler::Dynamic) {
+                size_t offset, length;
+                while (claimChunk(read_chunk_size, offset, length)) {
+                    bytes_completed += prefaultRange(thread_id, offset, length);
+                }
+            } else {
+                bytes_completed = prefaultRange(thread_id, section_start, section_size);
+            }
+        } else if (io_engine == IoEngine::IoUring) {
+            if (scheduler == Scheduler::Dynamic) {
+                bytes_completed = readSectionUring(thread_id, 0, file_size);
+            } else {
+                bytes_completed = readSectionUring(thread_id, section_start, section_size);
+            }
+        } else if (scheduler == Scheduler::Dynamic) {
+            // Claim a syscall's worth of chunks at a time
+            size_t claim_size = read_chunk_size * chunks_per_syscall;
+            size_t offset, length;
+            while (claimChunk(claim_size, offset, length)) {
+                size_t completed = readSection(thread_id, offset, length);
+                bytes_completed += completed;
+                if (completed < length) {
+                    break;
+                }
+            }
+        } else {
+            bytes_completed = readSection(thread_id, section_start, section_size);
+        }
+
+        auto thread_end = std::chrono::high_resolution_clock::now();
+        auto thread_duration = std::chrono::duration_cast<std::chrono::milliseconds>(thread_end - thread_start);
+
+        if (probing) {
+            return;
+        }
+        std::cout << "Thread " << thread_id << " completed: processed " << bytes_completed
+                  << " bytes in " << (bytes_completed + read_chunk_size - 1) / read_chunk_size
+                  << " chunks (" << thread_duration.count() << " ms)\n";
+    }
+
+    // Copy a range through the page cache: a buffered read, whatever use_odirect says.
+    // Used for cached ranges and, in hybrid mode, for the unaligned edges of sections.
+    // Drop-behind counts these bytes like any other buffered read
+    size_t readCached(size_t thread_id, size_t start, size_t size) {
+        int file = cached_fd != -1 ? cached_fd : fd;
+        size_t bytes_read = 0;
+        while (bytes_read < size) {
+            ssize_t n = ::pread(file, buffer + start + bytes_read, size - bytes_read, start + bytes_read);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Thread " << thread_id << ": Read error at offset " << start + bytes_read << "\n";
+                break;
+            }
+            if (n == 0) {
+                std::cerr << "Thread " << thread_id << ": Unexpected EOF at offset " << start + bytes_read << "\n";
+                break;
+            }
+            rangeRead(start + bytes_read, n);
+            dropBehind(start + bytes_read, n);
+            bytes_read += n;
+        }
+        return bytes_read;
+    }
+
+    // Split [read_from, file_size) into ranges by page cache residency, uncached ranges
+    // first so the device starts working at once while cached ones are copied at memory
+    // speed behind them. Uncached ranges are a ring's worth of chunks with io_uring
+    void planCacheAware(size_t read_from) {
+        std::vector<bool> chunk_hot;
+        double cached = scanResidency(read_chunk_size, &chunk_hot);
+
+        size_t cold_piece = read_chunk_size * (io_engine == IoEngine::IoUring ? queue_depth : chunks_per_syscall);
+        size_t hot_piece = read_chunk_size * chunks_per_syscall;
+        std::vector<ReadRange> cold, hot;
+        size_t cold_bytes = 0;
+        size_t offset = read_from;
+        while (offset < file_size) {
+            bool is_hot = chunk_hot[offset / read_chunk_size];
+            // Extend over following chunks with the same residency, up to one piece
+            size_t piece = is_hot ? hot_piece : cold_piece;
+            size_t end = std::min((offset / read_chunk_size + 1) * read_chunk_size, file_size);
+            while (end < file_size && end - offset < piece && chunk_hot[end / read_chunk_size] == is_hot) {
+                end = std::min(end + read_chunk_size, file_size);
+            }
+            (is_hot ? hot : cold).push_back(ReadRange{offset, end - offset, is_hot});
+            if (!is_hot) {
+                cold_bytes += end - offset;
+            }
+            offset = end;
+        }
+
+        read_plan = cold;
+        read_plan.insert(read_plan.end(), hot.begin(), hot.end());
+        next_range = 0;
+        std::cout << "Cache-aware order: " << static_cast<int>(cached * 100) << "% of file cached; "
+                  << cold.size() << " uncached ranges (" << cold_bytes / (1024.0 * 1024.0) << " MB) first, then "
+                  << hot.size() << " cached ranges by buffered copy\n";
+    }
+
+    // Cache-aware worker: claim ranges from the plan until it is exhausted. With
+    // io_uring the thread sets up one ring for all its uncached ranges and registers
+    // each range as it claims it
+    void readPlanned(size_t thread_id) {
+        auto thread_start = std::chrono::high_resolution_clock::now();
+        size_t bytes_completed = 0;
+        UringContext ctx;
+        bool ring_ready = false;
+
+        size_t index;
+        while ((index = next_range.fetch_add(1, std::memory_order_relaxed)) < read_plan.size()) {
+            const ReadRange& range = read_plan[index];
+            if (range.cached) {
+                bytes_completed += readCached(thread_id, range.offset, range.length);
+            } else if (io_engine == IoEngine::IoUring) {
+                if (!ring_ready) {
+                    setupUring(thread_id, ctx);
+                    ring_ready = true;
+                }
+                registerUring(thread_id, ctx, wholeBlocksStart(range.offset),
+                              wholeBlocksEnd(range.offset + range.length));
+                bytes_completed += readRangeUring(thread_id, ctx, range.offset, range.length);
+            } else {
+                bytes_completed += readSection(thread_id, range.offset, range.length);
+            }
+        }
+
+        auto thread_end = std::chrono::high_resolution_clock::now();
+        auto thread_duration = std::chrono::duration_cast<std::chrono::milliseconds>(thread_end - thread_start);
+
+        std::cout << "Thread " << thread_id << " completed: processed " << bytes_completed
+                  << " bytes in " << (bytes_completed + read_chunk_size - 1) / read_chunk_size
+                  << " chunks (" << thread_duration.count() << " ms)\n";
+    }
+
+    // Mount point holding the file, from /proc/self/mountinfo; tuning results are kept
+    // per mount. Also reports the filesystem type when fs_type is given
+    std::string mountOf(std::string* fs_type = nullptr) const {
+        struct stat stat_buf;
+        if (stat(filename.c_str(), &stat_buf) != 0) {
+            return "";
+        }
+        std::string device = std::to_string(major(stat_buf.st_dev)) + ":" + std::to_string(minor(stat_buf.st_dev));
+        std::ifstream mountinfo("/proc/self/mountinfo");
+        std::string line;
+        std::string mount_point;
+        while (std::getline(mountinfo, line)) {
+            // Fields: mount ID, parent ID, major:minor, root, mount point, ...
+            std::istringstream fields(line);
+            std::string id, parent, dev, root, point;
+            fields >> id >> parent >> dev >> root >> point;
+            if (dev == device) {
+                mount_point = point;  // The last match is the mount on top
+                size_t separator = line.find(" - ");
+                if (fs_type && separator != std::string::npos) {
+                    std::istringstream(line.substr(separator + 3)) >> *fs_type;
+                }
+            }
+        }
+        return mount_point.empty() ? "dev:" + device : mount_point;
+    }
+
+    // Alignment O_DIRECT needs for this file, see directAlignment()
+    void queryDirectAlignment() {
+        std::string source;
+        block_size = directAlignment(filename, &source);
+        std::cout << "O_DIRECT alignment: " << block_size << " bytes (" << source << ")\n";
+    }
+
+    // Fraction of the file's pages already in the page cache, from mincore() on a
+    // mapping that is never touched; 0 if the file cannot be mapped. When unit_hot is
+    // given it gets one flag per unit-sized range, set if all of its pages are cached
+    double scanResidency(size_t unit = 0, std::vector<bool>* unit_hot = nullptr) const {
+        if (unit_hot) {
+            unit_hot->assign((file_size + unit - 1) / unit, false);
+        }
+
+        int probe_fd = open(filename.c_str(), O_RDONLY);
+        if (probe_fd == -1) {
+            return 0;
+        }
+        void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, probe_fd, 0);
+        close(probe_fd);
+        if (mapping == MAP_FAILED) {
+            return 0;
+        }
+        if (unit_hot) {
+            unit_hot->assign(unit_hot->size(), true);
+        }
+
+        // Query a window at a time so the residency vector stays small for huge files
+        size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t window_pages = 1 << 16;
+        std::vector<unsigned char> resident(window_pages);
+        size_t total_pages = (file_size + page_size - 1) / page_size;
+        size_t cached_pages = 0;
+        for (size_t page = 0; page < total_pages; page += window_pages) {
+            size_t pages = std::min(window_pages, total_pages - page);
+            if (mincore(static_cast<char*>(mapping) + page * page_size, pages * page_size, resident.data()) != 0) {
+                break;
+            }
+            for (size_t i = 0; i < pages; ++i) {
+                if (resident[i] & 1) {
+                    ++cached_pages;
+                } else if (unit_hot) {
+                    // A page can straddle units: every unit it touches is cold
+                    size_t page_start = (page + i) * page_size;
+                    size_t page_last = std::min(page_start + page_size, file_size) - 1;
+                    for (size_t u = page_start / unit; u <= page_last / unit; ++u) {
+                        (*unit_hot)[u] = false;
+                    }
+                }
+            }
+        }
+        munmap(mapping, file_size);
+        return static_cast<double>(cached_pages) / total_pages;
+    }
+
+    // Pick num_threads (and queue_depth when not given) from where the data will come
+    // from: the page cache if most of the file is resident, otherwise the backing
+    // device's type and request queue from /sys/dev/block
+    void autoConfigure() {
+        size_t cpus = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        double cached = scanResidency();
+
+        std::string fs_type;
+        std::string mount = mountOf(&fs_type);
+        std::string queue = deviceQueuePath(filename);
+        int rotational = -1;
+        size_t nr_requests = 0;
+        std::ifstream(queue + "rotational") >> rotational;
+        std::ifstream(queue + "nr_requests") >> nr_requests;
+
+        std::string source;
+        unsigned depth = 32;
+        if (cached >= 0.9) {
+            // Copying from the page cache is memory bound: one thread per CPU
+            source = "page cache";
+            num_threads = cpus;
+        } else if (rotational == 1) {
+            // Parallel streams make a single disk seek between them
+            source = "rotational disk";
+            num_threads = 1;
+            depth = static_cast<unsigned>(std::max<size_t>(std::min<size_t>(nr_requests, 32), 1));
+        } else if (rotational == 0) {
+            // SSD/NVMe: enough threads for the CPUs, and the device queue shared between them
+            source = "solid-state device";
+            num_threads = cpus;
+            depth = static_cast<unsigned>(std::max<size_t>(4, std::min<size_t>(nr_requests / num_threads, 128)));
+        } else if (fs_type == "tmpfs" || fs_type == "ramfs") {
+            source = fs_type;
+            num_threads = cpus;
+        } else {
+            // No local block device (NFS, Lustre, GPFS, FUSE...): latency bound, so keep
+            // more requests in flight than there are CPUs to spread across servers
+            source = fs_type.empty() ? "unknown filesystem" : fs_type + " (no local block device)";
+            num_threads = std::min<size_t>(2 * cpus, 64);
+        }
+        if (queue_depth == 0) {
+            queue_depth = depth;
+        }
+
+        std::cout << "Auto configuration: " << mount << " on " << source;
+        if (nr_requests > 0) {
+            std::cout << " (nr_requests " << nr_requests << ")";
+        }
+        std::cout << ", " << static_cast<int>(cached * 100) << "% of file cached -> "
+                  << num_threads << " threads";
+        if (io_engine == IoEngine::IoUring) {
+            std::cout << ", queue depth " << queue_depth;
+        }
+        std::cout << "\n";
+    }
+
+    // Tuning cache: one "mount engine odirect threads chunk depth" line per configuration
+    static std::string tuningCachePath() {
+        const char* home = getenv("HOME");
+        return home ? std::string(home) + "/.cache/parallel_reader_tuning" : "";
+    }
+
+    std::string tuningKey(const std::string& mount) const {
+        return mount + " " + std::to_string(static_cast<int>(io_engine)) + " " + std::to_string(use_odirect ? 1 : 0)
+               + " " + std::to_string(num_threads);
+    }
+
+    bool loadTuning(const std::string& key, size_t& chunk, unsigned& depth) const {
+        std::ifstream cache(tuningCachePath());
+        std::string line;
+        while (std::getline(cache, line)) {
+            if (line.compare(0, key.size() + 1, key + " ") == 0) {
+                std::istringstream values(line.substr(key.size() + 1));
+                if (values >> chunk >> depth && chunk > 0 && depth > 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void saveTuning(const std::string& key, size_t chunk, unsigned depth) const {
+        std::string path = tuningCachePath();
+        if (path.empty()) {
+            return;
+        }
+        std::vector<std::string> lines;
+        {
+            std::ifstream cache(path);
+            std::string line;
+            while (std::getline(cache, line)) {
+                if (line.compare(0, key.size() + 1, key + " ") != 0) {
+                    lines.push_back(line);
+                }
+            }
+        }
+        lines.push_back(key + " " + std::to_string(chunk) + " " + std::to_string(depth));
+        mkdir((std::string(getenv("HOME")) + "/.cache").c_str(), 0755);
+        std::ofstream cache(path, std::ios::trunc);
+        for (const auto& line : lines) {
+            cache << line << "\n";
+        }
+        if (!cache) {
+            std::cerr << "Could not write tuning cache " << path << "\n";
+        }
+    }
+
+    // Bytes each thread reads in a trial: its share of target, but at least two chunks
+    static size_t tuningSlice(size_t chunk, size_t threads, size_t target) {
+        return std::max(2 * chunk, target / threads / chunk * chunk);
+    }
+
+    // Bytes all trials take on threads threads: one per chunk size, then (io_uring) one
+    // per depth at the chunk size that wins, which may be the largest
+    size_t tuningBytes(const std::vector<size_t>& chunks, size_t depth_trials, size_t threads, size_t target) const {
+        size_t total = 0;
+        for (size_t chunk : chunks) {
+            total += threads * tuningSlice(chunk, threads, target);
+        }
+        return total + depth_trials * threads * tuningSlice(chunks.back(), threads, target);
+    }
+
+    // One tuning trial: threads threads read consecutive sections of [offset, ...) with
+    // the given chunk size and depth. Returns MB/s and advances offset past the bytes read
+    double tuningTrial(size_t chunk, unsigned depth, size_t threads, size_t target, size_t& offset) {
+        size_t slice = tuningSlice(chunk, threads, target);
+
+        size_t saved_chunk = read_chunk_size;
+        unsigned saved_depth = queue_depth;
+        Scheduler saved_scheduler = scheduler;
+        read_chunk_size = chunk;
+        queue_depth = depth;
+        scheduler = Scheduler::Static;
+        probing = true;
+
+        size_t trial_start = offset;
+        auto start = std::chrono::high_resolution_clock::now();
+        pool->run(threads, [&](size_t i) {
+            placeThread(i);
+            readChunk(i, trial_start + i * slice, slice);
+        });
+        auto end = std::chrono::high_resolution_clock::now();
+
+        probing = false;
+        read_chunk_size = saved_chunk;
+        queue_depth = saved_depth;
+        scheduler = saved_scheduler;
+
+        offset += threads * slice;
+        double seconds = std::max(std::chrono::duration<double>(end - start).count(), 1e-6);
+        double throughput = (threads * slice / (1024.0 * 1024.0)) / seconds;
+        std::cout << "Tuning trial: " << chunk / 1024 << " KB chunks";
+        if (io_engine == IoEngine::IoUring) {
+            std::cout << ", depth " << depth;
+        }
+        std::cout << ": " << throughput << " MB/s\n";
+        return throughput;
+    }
+
+    // Auto mode: time a few chunk sizes, then (io_uring) queue depths, each on its own
+    // stretch at the front of the file, and keep the fastest. Those stretches are part
+    // of the read, so this returns the offset where the regular read continues. Every
+    // thread reads at least two chunks per trial; when that does not fit in half the
+    // file, all trials run on fewer threads so they stay comparable, and chunk sizes
+    // too large even for one thread are skipped. The winner is cached per mount so the
+    // next run skips the trials, unless a chunk size was skipped
+    size_t tuneChunkSize() {
+        tuned = true;
+        std::string key = tuningKey(mountOf());
+        size_t chunk;
+        unsigned depth;
+        if (loadTuning(key, chunk, depth)) {
+            read_chunk_size = chunk;
+            queue_depth = depth;
+            std::cout << "Tuned read chunk size: " << chunk / 1024 << " KB, queue depth " << depth
+                      << " (cached for " << key.substr(0, key.find(' ')) << ")\n";
+            return 0;
+        }
+
+        std::vector<size_t> chunk_sizes = {256 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024};
+        const unsigned depths[] = {8, 32, 128};
+        size_t depth_trials = io_engine == IoEngine::IoUring ? 3 : 0;
+        size_t trials = chunk_sizes.size() + depth_trials;
+        // Aim for a quarter of the file, and 256 MB per trial, but let large chunks
+        // stretch the trials to half the file
+        size_t target = std::min<size_t>(256UL << 20, file_size / 4 / trials);
+        size_t budget = file_size / 2;
+
+        bool complete = true;
+        while (!chunk_sizes.empty() && tuningBytes(chunk_sizes, depth_trials, 1, target) > budget) {
+            std::cout << "Tuning trial: " << chunk_sizes.back() / 1024 << " KB chunks skipped, file too small\n";
+            chunk_sizes.pop_back();
+            complete = false;
+        }
+        if (chunk_sizes.empty()) {
+            std::cout << "Tuning skipped: file too small to time chunk sizes\n";
+            return 0;
+        }
+        size_t threads = num_threads;
+        while (threads > 1 && tuningBytes(chunk_sizes, depth_trials, threads, target) > budget) {
+            --threads;
+        }
+        if (threads < num_threads) {
+            std::cout << "Tuning trials on " << threads << " of " << num_threads
+                      << " threads, so each reads at least two chunks\n";
+        }
+
+        size_t offset = 0;
+        double best = 0;
+        size_t best_chunk = read_chunk_size;
+        for (size_t candidate : chunk_sizes) {
+            double throughput = tuningTrial(candidate, queue_depth, threads, target, offset);
+            if (throughput > best) {
+                best = throughput;
+                best_chunk = candidate;
+            }
+        }
+        read_chunk_size = best_chunk;
+
+        if (io_engine == IoEngine::IoUring) {
+            best = 0;
+            unsigned best_depth = queue_depth;
+            for (unsigned candidate : depths) {
+                double throughput = tuningTrial(read_chunk_size, candidate, threads, target, offset);
+                if (throughput > best) {
+                    best = throughput;
+                    best_depth = candidate;
+                }
+            }
+            queue_depth = best_depth;
+        }
+
+        // The trials end on a multiple of their own chunk sizes, but dynamic claims and
+        // the io_uring registered pieces expect the read to resume on a boundary of
+        // the chosen one: read the gap up to it here
+        size_t resume = std::min((offset + read_chunk_size - 1) / read_chunk_size * read_chunk_size, file_size);
+        if (resume > offset) {
+            Scheduler saved_scheduler = scheduler;
+            scheduler = Scheduler::Static;
+            probing = true;
+            pool->run(1, [&](size_t i) {
+                placeThread(i);
+                readChunk(i, offset, resume - offset);
+            });
+            probing = false;
+            scheduler = saved_scheduler;
+            offset = resume;
+        }
+
+        std::cout << "Tuned read chunk size: " << read_chunk_size / 1024 << " KB, queue depth " << queue_depth;
+        if (complete) {
+            saveTuning(key, read_chunk_size, queue_depth);
+            std::cout << " (saved for " << key.substr(0, key.find(' ')) << ")\n";
+        } else {
+            std::cout << " (not saved, some chunk sizes were skipped)\n";
+        }
+        return offset;
+    }
+
+    // Allocate buffer (aligned if using O_DIRECT), on huge pages when requested;
+    // returns a description of the page size actually used
+    std::string allocateBuffer() {
+        const size_t thp_size = 2UL << 20;
+        if (huge_pages == HugePages::Huge2MB || huge_pages == HugePages::Huge1GB) {
+            bool gigantic = huge_pages == HugePages::Huge1GB;
+            size_t page_size = gigantic ? 1UL << 30 : thp_size;
+            size_t length = (file_size + page_size - 1) / page_size * page_size;
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (gigantic ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+            void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (mapping != MAP_FAILED) {
+                buffer = static_cast<char*>(mapping);
+                buffer_mapping_size = length;
+                return gigantic ? "1 GB hugetlb pages" : "2 MB hugetlb pages";
+            }
+            std::cerr << "hugetlb allocation failed (" << strerror(errno)
+                      << "), falling back to transparent huge pages\n";
+        }
+
+        if (huge_pages != HugePages::None) {
+            // 2 MB alignment lets THP back the buffer from its first byte
+            if (posix_memalign(reinterpret_cast<void**>(&buffer), thp_size, file_size) != 0) {
+                throw std::runtime_error("Failed to allocate aligned buffer");
+            }
+            buffer_malloced = true;
+            if (madvise(buffer, file_size, MADV_HUGEPAGE) != 0) {
+                std::cerr << "madvise(MADV_HUGEPAGE) failed: " << strerror(errno) << "\n";
+                return "4 KB pages";
+            }
+            return "transparent huge pages";
+        }
+
+        if (use_odirect) {
+            if (posix_memalign(reinterpret_cast<void**>(&buffer), block_size, file_size) != 0) {
+                throw std::runtime_error("Failed to allocate aligned buffer");
+            }
+            buffer_malloced = true;
+        } else {
+            buffer = new char[file_size];
+        }
+        return "4 KB pages";
+    }
+
+    void freeBuffer() {
+        if (buffer == nullptr) {
+            return;
+        }
+        if (buffer_mapping_size > 0) {
+            munmap(buffer, buffer_mapping_size);
+        } else if (buffer_malloced) {
+            free(buffer);
+        } else {
+            delete[] buffer;
+        }
+        buffer = nullptr;
+        buffer_mapping_size = 0;
+        buffer_malloced = false;
+    }
+
+    // Node index that thread_id's section of buffer belongs to
+    size_t threadNode(size_t thread_id) const {
+        if (pinning == ThreadPinning::Core) {
+            std::vector<int> all = topology->allCpus();
+            return topology->nodeOfCpu(all[thread_id % all.size()]);
+        }
+        return thread_id % topology->numNodes();
+    }
+
+    // Pin the calling pool worker for the task of thread_id. Workers are re-pinned
+    // per task because any worker may pick up any task index
+    void placeThread(size_t thread_id) {
+        if (pinning == ThreadPinning::None) {
+            return;
+        }
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (pinning == ThreadPinning::Core) {
+            std::vector<int> all = topology->allCpus();
+            CPU_SET(all[thread_id % all.size()], &cpu_set);
+        } else {
+            for (int cpu : topology->cpus(threadNode(thread_id))) {
+                CPU_SET(cpu, &cpu_set);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+            std::cerr << "Thread " << thread_id << ": Failed to set CPU affinity: " << strerror(errno) << "\n";
+        }
+    }
+
+    // Set the NUMA policy of the freshly allocated buffer before any page is touched
+    void placeBuffer() {
+        if (numa_policy == NumaPolicy::None) {
+            return;
+        }
+        int rc = 0;
+        if (numa_policy == NumaPolicy::Interleave) {
+            std::vector<size_t> nodes;
+            for (size_t i = 0; i < topology->numNodes(); ++i) {
+                nodes.push_back(i);
+            }
+            rc = topology->bind(buffer, file_size, MPOL_INTERLEAVE, nodes);
+        } else {
+            // Same static sections as read(), each bound to its thread's node
+            size_t section_size = file_size / num_threads;
+            for (size_t i = 0; i < num_threads && rc == 0; ++i) {
+                size_t length = i == num_threads - 1 ? file_size - i * section_size : section_size;
+                rc = topology->bind(buffer + i * section_size, length, MPOL_BIND, {threadNode(i)});
+            }
+        }
+        if (rc != 0) {
+            std::cerr << "Failed to apply NUMA memory policy: " << strerror(-rc) << "\n";
+        }
+    }
+
+    // Zero the whole buffer on the pool workers, one slice per worker
+    void parallelMemset() {
+        auto memset_start = std::chrono::high_resolution_clock::now();
+
+        size_t memset_chunk_size = file_size / num_threads;
+        size_t memset_remainder = file_size % num_threads;
+
+        pool->run(num_threads, [&](size_t i) {
+            placeThread(i);
+            size_t current_memset_offset = i * memset_chunk_size;
+            size_t current_chunk_size = memset_chunk_size;
+
+            // Give the last thread any remaining bytes
+            if (i == num_threads - 1) {
+                current_chunk_size += memset_remainder;
+            }
+
+            auto thread_memset_start = std::chrono::high_resolution_clock::now();
+            std::memset(buffer + current_memset_offset, 0, current_chunk_size);
+            auto thread_memset_end = std::chrono::high_resolution_clock::now();
+            auto thread_memset_duration = std::chrono::duration_cast<std::chrono::milliseconds>(thread_memset_end - thread_memset_start);
+            std::cout << "Memset thread " << i << ": " << current_chunk_size << " bytes in " << thread_memset_duration.count() << " ms\n";
+        });
+
+        auto memset_end = std::chrono::high_resolution_clock::now();
+        auto memset_duration = std::chrono::duration_cast<std::chrono::milliseconds>(memset_end - memset_start);
+        std::cout << "Parallel memset total: " << memset_duration.count() << " ms\n";
+    }
+
+public:
+    ParallelFileReader(const std::string& fname,
+                      size_t threads = std::thread::hardware_concurrency(),
+                      size_t chunk_size = 1024 * 1024,  // Default 1MB chunks
+                      bool odirect = false,  // Default: don't use O_DIRECT
+                      IoEngine engine = IoEngine::Sync,
+                      unsigned depth = 32)  // 0: default, or chosen along with an automatic thread count
+        : filename(fname), num_threads(threads), read_chunk_size(chunk_size), buffer(nullptr), use_odirect(odirect),
+          io_engine(engine), queue_depth(depth) {
+        file_size = fileSize(filename);
+        if (file_size == 0) {
+            throw std::runtime_error("File not found or empty: " + filename);
+        }
+        if (use_odirect) {
+            queryDirectAlignment();
+        }
+        // Ensure read_chunk_size is a multiple of block_size for O_DIRECT
+        if (use_odirect && read_chunk_size % block_size != 0) {
+            read_chunk_size = ((read_chunk_size + block_size - 1) / block_size) * block_size;
+        }
+        if (io_engine == IoEngine::Mmap && use_odirect) {
+            throw std::runtime_error("O_DIRECT cannot be combined with the mmap engine");
+        }
+        // threads == 0 asks for a thread count matched to the device and page cache state
+        if (num_threads == 0) {
+            autoConfigure();
+        }
+        if (queue_depth == 0) {
+            queue_depth = 32;
+        }
+        if (io_engine == IoEngine::IoUring) {
+            // Fail early if the kernel (or a seccomp policy) does not allow io_uring
+            IoUring probe(1);
+        }
+    }
+
+    ~ParallelFileReader() {
+        finishAsync();
+        if (fd != -1) {
+            close(fd);
+        }
+        freeBuffer();
+    }
+
+    // Number of read_chunk_size chunks the sync path fills with a single preadv
+    void setChunksPerSyscall(size_t chunks) {
+        chunks_per_syscall = std::max<size_t>(1, std::min<size_t>(chunks, IOV_MAX));
+    }
+
+    void setScheduler(Scheduler mode) {
+        scheduler = mode;
+    }
+
+    void setBufferInit(BufferInit mode) {
+        buffer_init = mode;
+    }
+
+    // Bind buffer pages to nodes and/or pin reader threads; both phases of read() follow it
+    void setNumaPlacement(NumaPolicy policy, ThreadPinning pin) {
+        numa_policy = policy;
+        pinning = pin;
+        if (numa_policy != NumaPolicy::None || pinning != ThreadPinning::None) {
+            topology.reset(new NumaTopology());
+        }
+    }
+
+    // Back the buffer with huge pages; takes effect when read() allocates it
+    void setHugePages(HugePages mode) {
+        huge_pages = mode;
+    }
+
+    // Share one pool between readers; otherwise the first read() creates one of num_threads workers
+    void setThreadPool(std::shared_ptr<ThreadPool> shared_pool) {
+        pool = std::move(shared_pool);
+    }
+
+    // Page cache hints for buffered reads: an fadvise policy, a readahead() window kept
+    // ahead of each thread (0: kernel readahead only) and drop-behind after reading
+    void setCacheAdvice(CacheAdvice advice, size_t readahead_bytes, bool drop) {
+        cache_advice = advice;
+        readahead_window = readahead_bytes;
+        drop_behind = drop;
+    }
+
+    // Compute CRC32C per chunk and for the whole file while reading (read() and stream())
+    void setChecksum(bool enable) {
+        checksum = enable;
+    }
+
+    // Size of the blocks getChunkChecksums() covers; 0 keeps one digest per read chunk
+    void setDigestBlockSize(size_t bytes) {
+        digest_block = bytes;
+    }
+
+    // Load a manifest of per-block CRC32C digests. Reads then check every block as it
+    // completes and re-read the blocks that fail, instead of a verify() pass
+    void setManifest(const std::string& path) {
+        std::ifstream input(path);
+        if (!input.is_open()) {
+            throw std::runtime_error("Failed to open manifest: " + path);
+        }
+        std::string line;
+        while (std::getline(input, line) && (line.empty() || line[0] == '#')) {
+        }
+        std::istringstream header(line);
+        std::string algorithm;
+        size_t block = 0;
+        size_t size = 0;
+        if (!(header >> algorithm >> block >> size) || algorithm != "crc32c" || block == 0) {
+            throw std::runtime_error("Bad manifest header in " + path + ": expected \"crc32c <block_size> <file_size>\"");
+        }
+        if (size != file_size) {
+            throw std::runtime_error("Manifest " + path + " is for a file of " + std::to_string(size)
+                                     + " bytes, not " + std::to_string(file_size));
+        }
+        std::vector<uint32_t> digests;
+        while (std::getline(input, line)) {
+            if (!line.empty() && line[0] != '#') {
+                digests.push_back(static_cast<uint32_t>(std::stoul(line, nullptr, 16)));
+            }
+        }
+        if (digests.size() != (file_size + block - 1) / block) {
+            throw std::runtime_error("Manifest " + path + " has " + std::to_string(digests.size())
+                                     + " digests, expected " + std::to_string((file_size + block - 1) / block));
+        }
+        manifest = digests;
+        digest_block = block;
+        checksum = true;
+    }
+
+    // Write the block digests of the last checksummed read as a manifest
+    void writeManifest(const std::string& path) const {
+        if (!checksum_complete) {
+            throw std::runtime_error("No complete set of block digests to write to " + path);
+        }
+        std::ofstream output(path, std::ios::trunc);
+        output << "# CRC32C per block of " << filename << "\n";
+        output << "crc32c " << checksum_chunk << " " << file_size << "\n";
+        char digest[16];
+        for (uint32_t crc : chunk_checksums) {
+            snprintf(digest, sizeof(digest), "%08x", crc);
+            output << digest << "\n";
+        }
+        if (!output) {
+            throw std::runtime_error("Failed to write manifest: " + path);
+        }
+    }
+
+    // Blocks that still failed the manifest after the last read's re-reads
+    const std::vector<size_t>& getCorruptBlocks() const {
+        return failed_chunks;
+    }
+
+    // Checksums of the last read() or stream() with setChecksum(true)
+    uint32_t getChecksum() const {
+        return file_checksum;
+    }
+
+    const std::vector<uint32_t>& getChunkChecksums() const {
+        return chunk_checksums;
+    }
+
+    // Let the first read() choose read_chunk_size (and queue_depth with io_uring)
+    void setAutoTune(bool enable) {
+        auto_tune = enable;
+        tuned = false;
+    }
+
+    // Probe page cache residency before each read(): read uncached ranges first (with
+    // O_DIRECT if enabled) and copy cached ranges with buffered reads. Sync and io_uring only
+    void setCacheAware(bool enable) {
+        cache_aware = enable;
+    }
+
+    // With O_DIRECT, read only block-aligned interiors direct and the unaligned head
+    // and tail of each section buffered, skipping the bounce buffer; files smaller
+    // than min_file_size are read buffered throughout
+    void setHybridDirect(bool enable, size_t min_file_size = 16 * 1024 * 1024) {
+        hybrid_direct = enable;
+        direct_min_file = min_file_size;
+    }
+
+    // Main function to read file in parallel
+    void read() {
+        finishAsync();
+        readFile();
+    }
+
+private:
+    // read() minus waiting for read_async(), whose background thread runs this
+    void readFile() {
+        auto read_call_start = std::chrono::high_resolution_clock::now();
+        struct rusage usage_start;
+        getrusage(RUSAGE_SELF, &usage_start);
+
+        // Allocate buffer equal to file size (or map the file); later calls reuse it
+        if (buffer == nullptr && io_engine == IoEngine::Mmap) {
+            auto map_start = std::chrono::high_resolution_clock::now();
+            mapFile();
+            auto map_end = std::chrono::high_resolution_clock::now();
+            auto map_duration = std::chrono::duration_cast<std::chrono::microseconds>(map_end - map_start);
+            std::cout << "File mapping: " << map_duration.count() << " μs (no buffer allocated)\n";
+        } else if (buffer == nullptr) {
+            auto alloc_start = std::chrono::high_resolution_clock::now();
+            std::string pages = allocateBuffer();
+            auto alloc_end = std::chrono::high_resolution_clock::now();
+            auto alloc_duration = std::chrono::duration_cast<std::chrono::microseconds>(alloc_end - alloc_start);
+            std::cout << "Buffer allocation: " << alloc_duration.count() << " μs (" << pages << ")\n";
+            placeBuffer();
+        }
+
+        // Start the worker threads once; every later read() reuses them
+        if (!pool) {
+            auto pool_start = std::chrono::high_resolution_clock::now();
+            pool = std::make_shared<ThreadPool>(num_threads);
+            auto pool_end = std::chrono::high_resolution_clock::now();
+            auto pool_duration = std::chrono::duration_cast<std::chrono::microseconds>(pool_end - pool_start);
+            std::cout << "Thread pool startup: " << pool_duration.count() << " μs ("
+                      << pool->size() << " workers)\n";
+        }
+
+        if (io_engine == IoEngine::Mmap) {
+            std::cout << "Parallel memset skipped: the file mapping is the buffer\n";
+        } else if (buffer_init == BufferInit::Memset) {
+            parallelMemset();
+        } else {
+            std::cout << "Parallel memset skipped: reader threads fault in the pages they read into\n";
+        }
+
+        std::cout << "Reading file: " << filename << "\n";
+        std::cout << "File size: " << file_size << " bytes ("
+                  << (file_size / (1024.0 * 1024.0)) << " MB)\n";
+        std::cout << "Using " << num_threads << " threads\n";
+        std::cout << "Read chunk size: " << read_chunk_size << " bytes ("
+                  << (read_chunk_size / 1024.0) << " KB)\n";
+        std::cout << "O_DIRECT: " << (use_odirect ? "enabled" : "disabled");
+        if (use_odirect) {
+            std::cout << " (bypasses page cache - shows TRUE storage performance)";
+        } else {
+            std::cout << " (uses page cache - may show cached performance on repeat runs)";
+        }
+        std::cout << "\n";
+        std::cout << "I/O engine: ";
+        if (io_engine == IoEngine::IoUring) {
+            std::cout << "io_uring (" << queue_depth << " reads in flight per thread)\n";
+        } else if (io_engine == IoEngine::Mmap) {
+            std::cout << "mmap (threads prefault disjoint ranges with MADV_POPULATE_READ)\n";
+        } else {
+            std::cout << "sync (one blocking read per thread)\n";
+        }
+
+        std::cout << "Scheduler: ";
+        if (scheduler == Scheduler::Dynamic) {
+            std::cout << "dynamic (threads claim chunks from a shared cursor)\n";
+        } else {
+            std::cout << "static (one contiguous section per thread)\n";
+        }
+        if (topology) {
+            const char* policy_names[] = {"none", "local", "interleave"};
+            const char* pinning_names[] = {"none", "node", "core"};
+            std::cout << "NUMA: " << topology->numNodes() << " node(s), memory policy "
+                      << policy_names[static_cast<int>(numa_policy)] << ", thread pinning "
+                      << pinning_names[static_cast<int>(pinning)] << "\n";
+        }
+        if (io_engine == IoEngine::Sync && chunks_per_syscall > 1) {
+            std::cout << "Chunks per syscall: " << chunks_per_syscall << " (vectored preadv)\n";
+        }
+        if (!use_odirect && io_engine != IoEngine::Mmap
+            && (cache_advice != CacheAdvice::None || readahead_window > 0 || drop_behind)) {
+            const char* advice_names[] = {"none", "normal", "sequential", "random", "noreuse", "willneed"};
+            std::cout << "Page cache: fadvise " << advice_names[static_cast<int>(cache_advice)]
+                      << ", readahead window " << readahead_window / 1024 << " KB"
+                      << (drop_behind ? ", drop-behind" : "") << "\n";
+        }
+
+        // Hybrid mode: O_DIRECT does not pay off on small files, so read them buffered
+        bool direct = use_odirect;
+        if (use_odirect && hybrid_direct && file_size < direct_min_file) {
+            use_odirect = false;
+            std::cout << "Hybrid I/O: file is below " << direct_min_file / (1024.0 * 1024.0)
+                      << " MB, reading it buffered\n";
+        } else if (use_odirect && hybrid_direct) {
+            std::cout << "Hybrid I/O: O_DIRECT for whole blocks, buffered reads for unaligned edges\n";
+        }
+        try {
+            openFile();
+        } catch (...) {
+            use_odirect = direct;
+            throw;
+        }
+        if (use_odirect && (cache_aware || hybrid_direct)) {
+            cached_fd = open(filename.c_str(), O_RDONLY);
+        }
+        resetChecksums();
+        resetDropBehind();
+        // Blocks failing the manifest are re-read below, except from a file mapping
+        manifest_final_pass = io_engine == IoEngine::Mmap;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        // Comparable across --buffer-init modes: the memset is the bulk of it when enabled
+        auto startup_duration = std::chrono::duration_cast<std::chrono::microseconds>(start - read_call_start);
+        std::cout << "Startup latency (read() call to first read): " << startup_duration.count() << " μs\n";
+
+        // Tuning trials read the front of the file; the rest is shared out as usual
+        size_t read_from = 0;
+        if (auto_tune && !tuned && io_engine != IoEngine::Mmap) {
+            read_from = tuneChunkSize();
+        }
+        next_chunk_offset = read_from;
+
+        // Calculate chunk size for each thread
+        size_t chunk_size = (file_size - read_from) / num_threads;
+        size_t remainder = (file_size - read_from) % num_threads;
+
+        if (cache_aware && io_engine != IoEngine::Mmap) {
+            planCacheAware(read_from);
+            // Planned ranges are whole sections for readSectionUring, not claims
+            Scheduler saved_scheduler = scheduler;
+            scheduler = Scheduler::Static;
+            pool->run(num_threads, [&](size_t i) {
+                placeThread(i);
+                readPlanned(i);
+            });
+            scheduler = saved_scheduler;
+        } else {
+            // Run one section per task on the pool and wait for all of them
+            pool->run(num_threads, [&](size_t i) {
+                size_t current_chunk_size = chunk_size;
+
+                // Give the last thread any remaining bytes
+                if (i == num_threads - 1) {
+                    current_chunk_size += remainder;
+                }
+
+                placeThread(i);
+                readChunk(i, read_from + i * chunk_size, current_chunk_size);
+            });
+        }
+
+        if (!failed_chunks.empty() && io_engine != IoEngine::Mmap) {
+            rereadFailedBlocks();
+        }
+        manifest_final_pass = true;
+
+        // Without the memset, bytes past a short file's current EOF hold garbage;
+        // zero only that unread tail
+        if (buffer_init == BufferInit::FirstTouch && io_engine != IoEngine::Mmap) {
+            struct stat stat_buf;
+            if (fstat(fd, &stat_buf) == 0 && static_cast<size_t>(stat_buf.st_size) < file_size) {
+                size_t unread = file_size - stat_buf.st_size;
+                std::memset(buffer + stat_buf.st_size, 0, unread);
+                std::cerr << "File shrank during read: zeroed the unread " << unread << " bytes\n";
+            }
+        }
+
+        close(fd);
+        fd = -1;
+        if (cached_fd != -1) {
+            close(cached_fd);
+            cached_fd = -1;
+        }
+        use_odirect = direct;
+
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+        std::cout << "\nRead completed in " << duration.count() << " ms\n";
+
+        // Faults taken by the memset and read phases; huge pages cut these by 512x or more
+        struct rusage usage_end;
+        getrusage(RUSAGE_SELF, &usage_end);
+        std::cout << "Page faults: " << (usage_end.ru_minflt - usage_start.ru_minflt) << " minor, "
+                  << (usage_end.ru_majflt - usage_start.ru_majflt) << " major\n";
+        double throughput = (file_size / (1024.0 * 1024.0)) / (duration.count() / 1000.0);
+        std::cout << "Throughput: " << throughput << " MB/s\n";
+        if (checksum) {
+            finishChecksums();
+            reportChecksums(duration.count() / 1000.0);
+        }
+    }
+
+public:
+    // Bounded-memory alternative to read(): reader threads fill a pool of pool_chunks
+    // aligned chunk buffers and the calling thread hands each filled chunk to
+    // consumer(offset, data, length), then recycles it. Peak memory is
+    // pool_chunks * read_chunk_size instead of file_size. Chunks arrive in file
+    // order when in_order is set, otherwise as soon as they are read. Reads are
+    // positional (pread) whatever the engine. Returns true if every byte was delivered
+    bool stream(size_t pool_chunks, const std::function<void(size_t, const char*, size_t)>& consumer,
+                bool in_order = true) {
+        pool_chunks = std::max<size_t>(pool_chunks, 1);
+        finishAsync();
+
+        if (!pool) {
+            pool = std::make_shared<ThreadPool>(num_threads);
+        }
+
+        StreamState state;
+        if (posix_memalign(reinterpret_cast<void**>(&state.slabs), block_size, pool_chunks * read_chunk_size) != 0) {
+            throw std::runtime_error("Failed to allocate stream buffer pool");
+        }
+        for (size_t i = pool_chunks; i > 0; --i) {
+            state.free_slots.push_back(static_cast<unsigned>(i - 1));
+        }
+
+        std::cout << "Streaming file: " << filename << "\n";
+        std::cout << "File size: " << file_size << " bytes ("
+                  << (file_size / (1024.0 * 1024.0)) << " MB)\n";
+        std::cout << "Using " << num_threads << " threads\n";
+        std::cout << "Buffer pool: " << pool_chunks << " x " << read_chunk_size << " bytes ("
+                  << (pool_chunks * read_chunk_size / (1024.0 * 1024.0)) << " MB peak), "
+                  << (in_order ? "in-order" : "out-of-order") << " delivery\n";
+
+        try {
+            openFile();
+        } catch (...) {
+            free(state.slabs);
+            throw;
+        }
+        next_chunk_offset = 0;
+        resetChecksums();
+        resetDropBehind();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto batch = pool->start(num_threads, [this, &state](size_t i) {
+            placeThread(i);
+            streamChunks(i, state);
+        });
+
+        size_t next_offset = 0;
+        size_t delivered = 0;
+        std::exception_ptr consumer_error;
+        while (delivered < file_size) {
+            unsigned slot;
+            size_t offset, length;
+            {
+                std::unique_lock<std::mutex> lock(state.mutex);
+                state.chunk_ready.wait(lock, [&]() {
+                    bool available = in_order ? state.filled.count(next_offset) > 0 : !state.filled.empty();
+                    return available || state.failed || state.readers_done == num_threads;
+                });
+                auto it = in_order ? state.filled.find(next_offset) : state.filled.begin();
+                if (it == state.filled.end()) {
+                    break;
+                }
+                offset = it->first;
+                slot = it->second.first;
+                length = it->second.second;
+                state.filled.erase(it);
+            }
+
+            try {
+                consumer(offset, state.slabs + static_cast<size_t>(slot) * read_chunk_size, length);
+            } catch (...) {
+                consumer_error = std::current_exception();
+                break;
+            }
+            delivered += length;
+            next_offset = offset + length;
+
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.free_slots.push_back(slot);
+            }
+            state.slot_free.notify_one();
+        }
+
+        // Release readers still waiting for a slot if the consumer stopped early
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (delivered < file_size) {
+                state.failed = true;
+            }
+        }
+        state.slot_free.notify_all();
+        batch->wait();
+
+        close(fd);
+        fd = -1;
+        free(state.slabs);
+
+        if (consumer_error) {
+            std::rethrow_exception(consumer_error);
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+        std::cout << "\nStream completed in " << duration.count() << " ms (" << delivered << " bytes delivered)\n";
+        double throughput = (delivered / (1024.0 * 1024.0)) / (duration.count() / 1000.0);
+        std::cout << "Throughput: " << throughput << " MB/s\n";
+        if (checksum) {
+            finishChecksums();
+            reportChecksums(duration.count() / 1000.0);
+        }
+
+        return delivered == file_size;
+    }
+
+    // read() with the processing overlapped: while the reader threads fill buffer,
+    // consumer_threads separate threads call fn(offset, data, length) on every piece
+    // of at most read_chunk_size bytes as soon as it has been read, in completion
+    // order. buffer stays valid afterwards as with read(). The first exception thrown
+    // by fn stops further calls and is rethrown once reading has finished. Returns
+    // true if every byte of the file was processed
+    bool process(size_t consumer_threads, const std::function<void(size_t, const char*, size_t)>& fn) {
+        finishAsync();
+        consumer_threads = std::max<size_t>(consumer_threads, 1);
+        if (!consumer_pool || consumer_pool->size() != consumer_threads) {
+            consumer_pool = std::make_shared<ThreadPool>(consumer_threads);
+        }
+
+        std::mutex mutex;
+        std::condition_variable range_ready;
+        std::deque<std::pair<size_t, size_t>> ready;  // (file offset, length) read but not yet processed
+        bool reading_done = false;
+        std::exception_ptr consumer_error;
+        std::atomic<size_t> processed{0};
+
+        range_done = [&](size_t offset, size_t length) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // Split multi-chunk preadv completions so consumers can share them
+                for (size_t done = 0; done < length; done += read_chunk_size) {
+                    ready.emplace_back(offset + done, std::min(read_chunk_size, length - done));
+                }
+            }
+            range_ready.notify_all();
+        };
+
+        auto consumers = consumer_pool->start(consumer_threads, [&](size_t) {
+            while (true) {
+                std::pair<size_t, size_t> range;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    range_ready.wait(lock, [&]() { return reading_done || !ready.empty(); });
+                    if (ready.empty()) {
+                        return;
+                    }
+                    range = ready.front();
+                    ready.pop_front();
+                    if (consumer_error) {
+                        continue;  // Drain without calling fn again
+                    }
+                }
+                try {
+                    fn(range.first, buffer + range.first, range.second);
+                    processed += range.second;
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!consumer_error) {
+                        consumer_error = std::current_exception();
+                    }
+                }
+            }
+        });
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::exception_ptr read_error;
+        try {
+            read();
+        } catch (...) {
+            read_error = std::current_exception();
+        }
+        auto read_end = std::chrono::high_resolution_clock::now();
+
+        range_done = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            reading_done = true;
+        }
+        range_ready.notify_all();
+        consumers->wait();
+
+        if (read_error) {
+            std::rethrow_exception(read_error);
+        }
+        if (consumer_error) {
+            std::rethrow_exception(consumer_error);
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        auto tail = std::chrono::duration_cast<std::chrono::milliseconds>(end - read_end);
+        std::cout << "Process completed in " << duration.count() << " ms with " << consumer_threads
+                  << " consumer threads (" << processed << " bytes processed, "
+                  << tail.count() << " ms after the last read)\n";
+
+        return processed == file_size;
+    }
+
+    // Start read() in the background and return at once. The handle reports which
+    // ranges of getBuffer() already hold file data, so a consumer can work on the
+    // front of the file while the rest is in flight. getBuffer() is set once any
+    // range is ready. Any other call on this reader first waits for the read to end
+    std::shared_ptr<ReadProgress> read_async() {
+        finishAsync();
+        auto progress = std::make_shared<ReadProgress>(read_chunk_size, file_size);
+        range_done = [progress](size_t offset, size_t length) {
+            progress->add(offset, length);
+        };
+        async_thread = std::thread([this, progress]() {
+            std::exception_ptr read_error;
+            try {
+                readFile();
+            } catch (...) {
+                read_error = std::current_exception();
+            }
+            range_done = nullptr;
+            progress->finish(read_error);
+        });
+        return progress;
+    }
+
+    // Get the buffer (for verification or further processing); with the mmap
+    // engine this is the read-only file mapping itself
+    const char* getBuffer() const {
+        return buffer;
+    }
+
+    size_t getFileSize() const {
+        return file_size;
+    }
+
+    // Verify the read against a fresh buffered read of the file. The pool's threads
+    // claim chunks and compare each through their own chunk-sized buffer, so memory
+    // stays at threads * read_chunk_size; reports the first mismatching offset
+    bool verify() {
+        finishAsync();
+        std::cout << "\nVerifying parallel read...\n";
+        if (buffer == nullptr) {
+            std::cerr << "Nothing to verify: the file has not been read\n";
+            return false;
+        }
+
+        // Use regular file I/O for verification (not O_DIRECT) to avoid alignment issues
+        int verify_fd = open(filename.c_str(), O_RDONLY);
+        if (verify_fd == -1) {
+            std::cerr << "Failed to open file for verification\n";
+            return false;
+        }
+        if (!pool) {
+            pool = std::make_shared<ThreadPool>(num_threads);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::atomic<size_t> next_offset{0};
+        std::atomic<size_t> first_mismatch{SIZE_MAX};
+        std::atomic<bool> short_read{false};
+
+        pool->run(pool->size(), [&](size_t) {
+            std::vector<char> expected(read_chunk_size);
+            size_t offset;
+            while ((offset = next_offset.fetch_add(read_chunk_size, std::memory_order_relaxed)) < file_size) {
+                // Claims only move forward, so nothing from here on can be earlier
+                if (offset >= first_mismatch.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                size_t length = std::min(read_chunk_size, file_size - offset);
+                size_t got = 0;
+                while (got < length) {
+                    ssize_t n = ::pread(verify_fd, expected.data() + got, length - got, offset + got);
+                    if (n == -1 && errno == EINTR) {
+                        continue;
+                    }
+                    if (n <= 0) {
+                        break;
+                    }
+                    got += n;
+                }
+
+                size_t mismatch = SIZE_MAX;
+                if (std::memcmp(buffer + offset, expected.data(), got) != 0) {
+                    mismatch = offset;
+                    while (buffer[mismatch] == expected[mismatch - offset]) {
+                        ++mismatch;
+                    }
+                } else if (got < length) {
+                    short_read = true;
+                    mismatch = offset + got;
+                }
+                size_t seen = first_mismatch.load();
+                while (mismatch < seen && !first_mismatch.compare_exchange_weak(seen, mismatch)) {
+                }
+            }
+        });
+        close(verify_fd);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Verify completed in " << duration.count() << " ms (" << pool->size() << " threads)\n";
+
+        size_t mismatch = first_mismatch.load();
+        if (mismatch == SIZE_MAX) {
+            std::cout << "Verification PASSED: Parallel read matches sequential read\n";
+            return true;
+        }
+        std::cout << "Verification FAILED: Data mismatch detected at offset " << mismatch;
+        if (short_read && mismatch < file_size) {
+            std::cout << " (file ended early)";
+        }
+        std::cout << "\n";
+        return false;
+    }
+};
+
+// Reads several files into memory at once with one pool and one work list. Chunks
+// of all files are handed out round-robin, so with files on different devices every
+// device has requests queued from the start, and a file that ends early frees its
+// threads for the others. Besides the thread count, the I/O budget can cap the reads
+// in flight per file, so one slow device cannot tie up every thread. Each file gets
+// its own buffer, or all of them share one concatenated buffer. Reads are positional
+// pread, with O_DIRECT if requested; chunks whose file offset or destination is not
+// aligned go through a bounce buffer. Instead of whole files it can also read byte
+// ranges of files to given places in one output buffer, which is how the VDS reader
+// assembles sources
+class BatchFileReader {
+public:
+    // length bytes at file_offset in name, to output_offset in the output buffer
+    struct Range {
+        std::string name;
+        size_t file_offset;
+        size_t length;
+        size_t output_offset;
+    };
+
+private:
+    // One chunk of one file
+    struct BatchItem {
+        size_t file;
+        size_t offset;
+        size_t length;
+    };
+
+    struct BatchFile {
+        std::string name;
+        size_t start = 0;        // File offset of the first byte to read
+        size_t size = 0;
+        size_t offset = 0;       // Start within the concatenated buffer
+        char* buffer = nullptr;  // Destination of byte 0 of this file
+        int fd = -1;
+        std::atomic<size_t> remaining{0};  // Bytes not read yet
+        long finished_ms = -1;             // When the last byte arrived, from the start of read()
+        std::vector<BatchItem> items;      // Chunks in file order
+        size_t next_item = 0;              // First chunk not claimed yet, under claim_mutex
+        size_t in_flight = 0;              // Chunks claimed but not read yet, under claim_mutex
+    };
+
+    std::vector<std::unique_ptr<BatchFile>> files;
+    size_t num_threads;
+    size_t read_chunk_size;
+    bool use_odirect;
+    bool concatenated = false;
+    size_t max_in_flight_per_file = 0;  // 0 = only bounded by the thread count
+    size_t block_size = 0;              // O_DIRECT alignment: the largest any of the files needs
+    size_t total_size = 0;
+    char* concat_buffer = nullptr;
+    std::mutex claim_mutex;
+    std::condition_variable claim_ready;
+    size_t next_file = 0;  // Where the round-robin resumes, under claim_mutex
+    std::shared_ptr<ThreadPool> pool;
+
+    // Settle the alignment once every file's is known, and keep chunks whole blocks
+    void alignChunks() {
+        if (block_size == 0) {
+            block_size = 4096;
+        }
+        if (use_odirect && read_chunk_size % block_size != 0) {
+            read_chunk_size = ((read_chunk_size + block_size - 1) / block_size) * block_size;
+        }
+    }
+
+    // Split every file into chunks. Chunk boundaries sit on multiples of the chunk
+    // size in the file, so a range that starts mid-chunk only has a short first chunk
+    size_t planItems() {
+        size_t count = 0;
+        for (size_t i = 0; i < files.size(); ++i) {
+            BatchFile& file = *files[i];
+            file.items.clear();
+            size_t offset = 0;
+            while (offset < file.size) {
+                size_t pos = file.start + offset;
+                size_t next = (pos / read_chunk_size + 1) * read_chunk_size;
+                size_t length = std::min(next - pos, file.size - offset);
+                file.items.push_back(BatchItem{i, offset, length});
+                offset += length;
+            }
+            count += file.items.size();
+        }
+        return count;
+    }
+
+    void resetClaims() {
+        for (auto& file : files) {
+            file->next_item = 0;
+            file->in_flight = 0;
+        }
+        next_file = 0;
+    }
+
+    // Take the next chunk round-robin over the files, skipping files that already
+    // have max_per_file chunks in flight (0 = no limit). Waits while every file with
+    // chunks left is at its limit; returns false once all chunks are claimed
+    bool claimItem(BatchItem& item, size_t max_per_file) {
+        std::unique_lock<std::mutex> lock(claim_mutex);
+        for (;;) {
+            bool pending = false;
+            for (size_t k = 0; k < files.size(); ++k) {
+                size_t i = (next_file + k) % files.size();
+                BatchFile& file = *files[i];
+                if (file.next_item == file.items.size()) {
+                    continue;
+                }
+                pending = true;
+                if (max_per_file > 0 && file.in_flight >= max_per_file) {
+                    continue;
+                }
+                item = file.items[file.next_item++];
+                ++file.in_flight;
+                next_file = i + 1;
+                return true;
+            }
+            if (!pending) {
+                // Threads still waiting would otherwise only be woken by a release
+                claim_ready.notify_all();
+                return false;
+            }
+            claim_ready.wait(lock);
+        }
+    }
+
+    void releaseItem(const BatchItem& item) {
+        {
+            std::lock_guard<std::mutex> lock(claim_mutex);
+            --files[item.file]->in_flight;
+        }
+        claim_ready.notify_one();
+    }
+
+    // Read one item; returns the bytes placed in its file's buffer
+    size_t readItem(const BatchItem& item, char* bounce) {
+        BatchFile& file = *files[item.file];
+        char* dest = file.buffer + item.offset;
+        size_t pos = file.start + item.offset;
+        bool aligned = !use_odirect || (reinterpret_cast<uintptr_t>(dest) % block_size == 0
+                                        && pos % block_size == 0 && item.length % block_size == 0);
+        ssize_t n = aligned ? preadFull(file.fd, dest, item.length, pos, use_odirect ? block_size : 0)
+                            : preadBounced(file.fd, bounce, block_size, dest, item.length, pos);
+        if (n == -1) {
+            std::cerr << file.name << ": Read error at offset " << pos << ": " << strerror(errno) << "\n";
+            return 0;
+        }
+        if (static_cast<size_t>(n) < item.length) {
+            std::cerr << file.name << ": Unexpected EOF at offset " << pos + n << "\n";
+        }
+        return n;
+    }
+
+public:
+    BatchFileReader(const std::vector<std::string>& names,
+                    size_t threads = std::thread::hardware_concurrency(),
+                    size_t chunk_size = 1024 * 1024,
+                    bool odirect = false)
+        : num_threads(std::max<size_t>(threads, 1)), read_chunk_size(chunk_size), use_odirect(odirect) {
+        if (names.empty()) {
+            throw std::runtime_error("No files to read");
+        }
+        for (const auto& name : names) {
+            std::unique_ptr<BatchFile> file(new BatchFile());
+            file->name = name;
+            struct stat stat_buf;
+            if (stat(name.c_str(), &stat_buf) != 0) {
+                throw std::runtime_error("File not found: " + name);
+            }
+            file->size = fileSize(name);
+            if (use_odirect) {
+                block_size = std::max(block_size, directAlignment(name));
+            }
+            files.push_back(std::move(file));
+        }
+        alignChunks();
+        for (auto& file : files) {
+            file->offset = total_size;
+            total_size += file->size;
+        }
+    }
+
+    // Read ranges into one output buffer of output_size bytes. Bytes no range
+    // covers are left for the caller to fill
+    BatchFileReader(const std::vector<Range>& ranges,
+                    size_t output_size,
+                    size_t threads = std::thread::hardware_concurrency(),
+                    size_t chunk_size = 1024 * 1024,
+                    bool odirect = false)
+        : num_threads(std::max<size_t>(threads, 1)), read_chunk_size(chunk_size), use_odirect(odirect),
+          concatenated(true), total_size(output_size) {
+        if (ranges.empty()) {
+            throw std::runtime_error("No ranges to read");
+        }
+        for (const auto& range : ranges) {
+            if (range.output_offset + range.length > output_size) {
+                throw std::runtime_error("Range of " + range.name + " ends past the output buffer");
+            }
+            std::unique_ptr<BatchFile> file(new BatchFile());
+            file->name = range.name;
+            file->start = range.file_offset;
+            file->size = range.length;
+            file->offset = range.output_offset;
+            if (use_odirect) {
+                block_size = std::max(block_size, directAlignment(range.name));
+            }
+            files.push_back(std::move(file));
+        }
+        alignChunks();
+    }
+
+    ~BatchFileReader() {
+        for (auto& file : files) {
+            if (file->fd != -1) {
+                close(file->fd);
+            }
+            if (!concatenated) {
+                free(file->buffer);
+            }
+        }
+        free(concat_buffer);
+    }
 
-    // Get file size
-    size_t getFileSize(const std::string& filename) {
-        struct stat stat_buf;
-        int rc = stat(filename.c_str(), &stat_buf);
-        return rc == 0 ? stat_buf.st_size : 0;
+    BatchFileReader(const BatchFileReader&) = delete;
+    BatchFileReader& operator=(const BatchFileReader&) = delete;
+
+    // Place all files back to back in one buffer instead of one buffer per file
+    void setConcatenated(bool enable) {
+        concatenated = enable;
     }
 
-    // Thread worker function to read a portion of the file in configurable chunks
-    void readChunk(size_t thread_id, size_t section_start, size_t section_size) {
-        auto thread_start = std::chrono::high_resolution_clock::now();
+    // At most reads chunks of any one file in flight at once; 0 removes the limit
+    void setMaxInFlightPerFile(size_t reads) {
+        max_in_flight_per_file = reads;
+    }
 
-        int flags = O_RDONLY;
-        if (use_odirect) {
-            flags |= O_DIRECT;
+    void setThreadPool(std::shared_ptr<ThreadPool> shared_pool) {
+        pool = std::move(shared_pool);
+    }
+
+    void read() {
+        // Allocate the destination(s) once; later calls reuse them
+        if (concat_buffer == nullptr && files[0]->buffer == nullptr) {
+            if (concatenated) {
+                if (posix_memalign(reinterpret_cast<void**>(&concat_buffer), block_size,
+                                   std::max<size_t>(total_size, 1)) != 0) {
+                    throw std::runtime_error("Failed to allocate the concatenated buffer");
+                }
+                for (auto& file : files) {
+                    file->buffer = concat_buffer + file->offset;
+                }
+            } else {
+                for (auto& file : files) {
+                    if (posix_memalign(reinterpret_cast<void**>(&file->buffer), block_size,
+                                       std::max<size_t>(file->size, 1)) != 0) {
+                        throw std::runtime_error("Failed to allocate buffer for " + file->name);
+                    }
+                }
+            }
         }
-        int fd = open(filename.c_str(), flags);
-        if (fd == -1) {
-            std::cerr << "Thread " << thread_id << ": Failed to open file\n";
-            return;
+        if (!pool) {
+            pool = std::make_shared<ThreadPool>(num_threads);
         }
 
-        size_t bytes_completed = 0;
+        for (auto& file : files) {
+            file->fd = open(file->name.c_str(), O_RDONLY | (use_odirect ? O_DIRECT : 0));
+            if (file->fd == -1) {
+                throw std::runtime_error("Failed to open file: " + file->name);
+            }
+            file->remaining = file->size;
+            file->finished_ms = file->size == 0 ? 0 : -1;
+        }
+        size_t item_count = planItems();
+        resetClaims();
 
+        std::cout << "Batch: " << files.size() << " files, " << total_size << " bytes ("
+                  << (total_size / (1024.0 * 1024.0)) << " MB), " << num_threads << " threads, "
+                  << read_chunk_size / 1024 << " KB chunks, " << item_count << " chunks, "
+                  << (concatenated ? "one concatenated buffer" : "one buffer per file");
+        if (max_in_flight_per_file > 0) {
+            std::cout << ", at most " << max_in_flight_per_file << " reads in flight per file";
+        }
         if (use_odirect) {
-            // O_DIRECT path: requires aligned reads
-            // Allocate a temporary aligned buffer for reading
-            auto temp_alloc_start = std::chrono::high_resolution_clock::now();
-            char* temp_buffer;
-            if (posix_memalign(reinterpret_cast<void**>(&temp_buffer), block_size, read_chunk_size) != 0) {
+            std::cout << ", O_DIRECT with " << block_size << "-byte alignment";
+        }
+        std::cout << "\n";
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::atomic<size_t> bytes_read{0};
+        pool->run(num_threads, [&](size_t thread_id) {
+            char* bounce = nullptr;
+            // Room for a chunk that starts and ends mid-block
+            if (use_odirect && posix_memalign(reinterpret_cast<void**>(&bounce), block_size,
+                                              read_chunk_size + 2 * block_size) != 0) {
                 std::cerr << "Thread " << thread_id << ": Failed to allocate aligned temp buffer\n";
-                close(fd);
                 return;
             }
-            auto temp_alloc_end = std::chrono::high_resolution_clock::now();
-            auto temp_alloc_duration = std::chrono::duration_cast<std::chrono::microseconds>(temp_alloc_end - temp_alloc_start);
-            std::cout << "Thread " << thread_id << " temp buffer allocation: " << temp_alloc_duration.count() << " μs\n";
+            BatchItem item;
+            while (claimItem(item, max_in_flight_per_file)) {
+                size_t got = readItem(item, bounce);
+                releaseItem(item);
+                bytes_read += got;
+                BatchFile& file = *files[item.file];
+                if (file.remaining.fetch_sub(got) == got) {
+                    auto now = std::chrono::high_resolution_clock::now();
+                    file.finished_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+                }
+            }
+            free(bounce);
+        });
+        auto end = std::chrono::high_resolution_clock::now();
 
-            size_t bytes_processed = 0;
-            size_t current_offset = section_start;
+        for (auto& file : files) {
+            close(file->fd);
+            file->fd = -1;
+            std::cout << "  " << file->name << ": " << file->size - file->remaining << " of " << file->size
+                      << " bytes, done at " << file->finished_ms << " ms\n";
+        }
 
-            // Read the section in aligned chunks
-            while (bytes_processed < section_size) {
-                // Calculate aligned read parameters
-                size_t aligned_offset = (current_offset / block_size) * block_size;
-                size_t offset_in_block = current_offset - aligned_offset;
-                size_t remaining_in_section = section_size - bytes_processed;
-                size_t bytes_to_read = std::min(read_chunk_size, remaining_in_section + offset_in_block);
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "\nBatch read completed in " << duration.count() << " ms\n";
+        double throughput = (bytes_read / (1024.0 * 1024.0)) / (duration.count() / 1000.0);
+        std::cout << "Throughput: " << throughput << " MB/s\n";
+    }
 
-                // Ensure read size is multiple of block_size
-                bytes_to_read = ((bytes_to_read + block_size - 1) / block_size) * block_size;
+    size_t getFileCount() const {
+        return files.size();
+    }
 
-                // Seek to aligned position
-                if (lseek(fd, aligned_offset, SEEK_SET) == -1) {
-                    std::cerr << "Thread " << thread_id << ": Seek error at offset "
-                              << aligned_offset << "\n";
-                    break;
-                }
+    // Contents of file index; in concatenated mode these are slices of one buffer
+    const char* getBuffer(size_t index) const {
+        return files[index]->buffer;
+    }
 
-                // Read aligned chunk into temp buffer
-                ssize_t actually_read = ::read(fd, temp_buffer, bytes_to_read);
+    size_t getFileSize(size_t index) const {
+        return files[index]->size;
+    }
 
-                if (actually_read == -1) {
-                    std::cerr << "Thread " << thread_id << ": Read error at offset "
-                              << aligned_offset << "\n";
-                    break;
-                }
+    // Concatenated mode: the whole buffer and its length
+    char* getConcatenatedBuffer() {
+        return concat_buffer;
+    }
 
-                // Copy only the needed portion to the main buffer
-                size_t bytes_to_copy = std::min(static_cast<size_t>(actually_read) - offset_in_block, remaining_in_section);
-                std::memcpy(buffer + current_offset, temp_buffer + offset_in_block, bytes_to_copy);
+    const char* getConcatenatedBuffer() const {
+        return concat_buffer;
+    }
 
-                bytes_processed += bytes_to_copy;
-                current_offset += bytes_to_copy;
+    size_t getTotalSize() const {
+        return total_size;
+    }
 
-                // Break if we reach EOF or read less than expected
-                if (actually_read < static_cast<ssize_t>(bytes_to_read)) {
-                    break;
+    // Compare every file chunk by chunk against a fresh buffered read, in parallel
+    bool verify() {
+        std::cout << "\nVerifying batch read...\n";
+        if (!pool || (concat_buffer == nullptr && files[0]->buffer == nullptr)) {
+            std::cerr << "Nothing to verify: the files have not been read\n";
+            return false;
+        }
+        std::vector<int> fds;
+        for (auto& file : files) {
+            fds.push_back(open(file->name.c_str(), O_RDONLY));
+        }
+        resetClaims();
+        std::atomic<bool> match{true};
+        pool->run(pool->size(), [&](size_t) {
+            std::vector<char> expected(read_chunk_size);
+            BatchItem item;
+            while (claimItem(item, 0)) {
+                const BatchFile& file = *files[item.file];
+                ssize_t n = preadFull(fds[item.file], expected.data(), item.length, file.start + item.offset, 0);
+                releaseItem(item);
+                if (n != static_cast<ssize_t>(item.length)
+                    || std::memcmp(file.buffer + item.offset, expected.data(), item.length) != 0) {
+                    std::cout << "Mismatch in " << file.name << " at file offset "
+                              << file.start + item.offset << "\n";
+                    match = false;
                 }
             }
+        });
+        for (int verify_fd : fds) {
+            if (verify_fd != -1) {
+                close(verify_fd);
+            }
+        }
 
-            free(temp_buffer);
-            bytes_completed = bytes_processed;
+        if (match) {
+            std::cout << "Verification PASSED: Batch read matches sequential read\n";
         } else {
-            // Regular I/O path: simpler logic
-            size_t bytes_read = 0;
-            size_t current_offset = section_start;
+            std::cout << "Verification FAILED: Data mismatch detected\n";
+        }
+        return match;
+    }
+};
 
-            // Read the section in chunks of read_chunk_size
-            while (bytes_read < section_size) {
-                size_t bytes_to_read = std::min(read_chunk_size, section_size - bytes_read);
+#ifdef WITH_HDF5
+// Owns an HDF5 identifier and closes it with the matching H5*close function
+class H5Handle {
+private:
+    hid_t id;
+    herr_t (*closer)(hid_t);
 
-                // Seek to the current position
-                if (lseek(fd, current_offset, SEEK_SET) == -1) {
-                    std::cerr << "Thread " << thread_id << ": Seek error at offset "
-                              << current_offset << "\n";
-                    break;
-                }
+public:
+    H5Handle(hid_t handle, herr_t (*close_fn)(hid_t), const std::string& what) : id(handle), closer(close_fn) {
+        if (id < 0) {
+            throw std::runtime_error("HDF5: failed to " + what);
+        }
+    }
 
-                // Read chunk directly into buffer at correct offset
-                ssize_t actually_read = ::read(fd, buffer + current_offset, bytes_to_read);
+    ~H5Handle() {
+        closer(id);
+    }
 
-                if (actually_read == -1) {
-                    std::cerr << "Thread " << thread_id << ": Read error at offset "
-                              << current_offset << "\n";
-                    break;
-                }
+    H5Handle(const H5Handle&) = delete;
+    H5Handle& operator=(const H5Handle&) = delete;
 
-                bytes_read += actually_read;
-                current_offset += actually_read;
+    operator hid_t() const {
+        return id;
+    }
+};
 
-                // If we couldn't read as much as expected and we're not at EOF, something's wrong
-                if (actually_read < static_cast<ssize_t>(bytes_to_read) && actually_read > 0) {
-                    std::cerr << "Thread " << thread_id << ": Short read at offset "
-                              << current_offset << "\n";
-                    break;
-                }
+// Assembles an HDF5 virtual dataset (VDS) such as the ones hd5/write_vds.py makes,
+// without going through libhdf5's VDS read path. The virtual mappings are resolved
+// with libhdf5 once; every source must be a contiguous dataset mapped to a block
+// of whole frames (axis 0). Its raw storage is then a single byte range of the
+// source file, and all ranges are read with BatchFileReader straight into their
+// frames of one (frames, ...) buffer. Frames no source covers get the VDS fill
+// value, frames of a source that was never written get that source's fill value
+class VdsReader {
+private:
+    struct Mapping {
+        std::string source;     // Source file path as resolved
+        std::string dataset;    // Dataset name in the source file
+        size_t first_frame;     // Frames [first_frame, first_frame + frames) of the VDS
+        size_t frames;
+        size_t file_offset;     // Byte offset of the source frames in the source file
+        bool allocated;         // False if the source was never written
+        std::vector<char> fill; // The source's fill value, which reads of it return if not allocated
+    };
 
-                // Break if we reach EOF
-                if (actually_read == 0) {
-                    break;
-                }
-            }
+    std::string vds_path;
+    std::string dataset_name;
+    size_t num_threads;
+    size_t read_chunk_size;
+    bool use_odirect;
+    std::vector<hsize_t> shape;
+    size_t element_size = 0;
+    size_t frame_bytes = 0;
+    std::vector<char> fill_value;
+    std::vector<Mapping> mappings;
+    std::unique_ptr<BatchFileReader> batch_reader;
 
-            bytes_completed = bytes_read;
+    // The frames a selection covers, requiring that it is one block of whole frames
+    static std::pair<size_t, size_t> frameBlock(hid_t space, const std::string& what) {
+        int rank = H5Sget_simple_extent_ndims(space);
+        hssize_t points = H5Sget_select_npoints(space);
+        if (rank < 1 || points < 0) {
+            throw std::runtime_error(what + ": unsupported selection");
         }
-
-        close(fd);
-
-        auto thread_end = std::chrono::high_resolution_clock::now();
-        auto thread_duration = std::chrono::duration_cast<std::chrono::milliseconds>(thread_end - thread_start);
-
-        std::cout << "Thread " << thread_id << " completed: processed " << bytes_completed
-                  << " bytes in " << (bytes_completed + read_chunk_size - 1) / read_chunk_size
-                  << " chunks (" << thread_duration.count() << " ms)\n";
-    }
-
-public:
-    ParallelFileReader(const std::string& fname,
-                      size_t threads = std::thread::hardware_concurrency(),
-                      size_t chunk_size = 1024 * 1024,  // Default 1MB chunks
-                      bool odirect = false)  // Default: don't use O_DIRECT
-        : filename(fname), num_threads(threads), read_chunk_size(chunk_size), buffer(nullptr), use_odirect(odirect) {
-        // Ensure read_chunk_size is a multiple of block_size for O_DIRECT
-        if (use_odirect && read_chunk_size % block_size != 0) {
-            read_chunk_size = ((read_chunk_size + block_size - 1) / block_size) * block_size;
+        if (points == 0) {
+            return {0, 0};
         }
-        file_size = getFileSize(filename);
-        if (file_size == 0) {
-            throw std::runtime_error("File not found or empty: " + filename);
+        std::vector<hsize_t> dims(rank), start(rank), end(rank);
+        if (H5Sget_simple_extent_dims(space, dims.data(), nullptr) < 0
+            || H5Sget_select_bounds(space, start.data(), end.data()) < 0) {
+            throw std::runtime_error(what + ": unsupported selection");
         }
-    }
-
-    ~ParallelFileReader() {
-        if (buffer != nullptr) {
-            if (use_odirect) {
-                free(buffer);
-            } else {
-                delete[] buffer;
+        size_t frame_points = 1;
+        for (int d = 1; d < rank; ++d) {
+            if (start[d] != 0 || end[d] != dims[d] - 1) {
+                throw std::runtime_error(what + ": selection does not cover whole frames");
             }
+            frame_points *= dims[d];
         }
+        size_t frames = end[0] - start[0] + 1;
+        if (static_cast<size_t>(points) != frames * frame_points) {
+            throw std::runtime_error(what + ": selection is not one block of frames");
+        }
+        return {start[0], frames};
     }
 
-    // Main function to read file in parallel
-    void read() {
-
-        // Allocate buffer equal to file size (aligned if using O_DIRECT)
-        auto alloc_start = std::chrono::high_resolution_clock::now();
-        if (use_odirect) {
-            if (posix_memalign(reinterpret_cast<void**>(&buffer), block_size, file_size) != 0) {
-                throw std::runtime_error("Failed to allocate aligned buffer");
+    // Where libhdf5 would find a source: "." is the VDS file itself, relative names
+    // are tried under $HDF5_VDS_PREFIX, next to the VDS file, then as given
+    std::string resolveSource(const std::string& name) const {
+        if (name == ".") {
+            return vds_path;
+        }
+        if (name.find('%') != std::string::npos) {
+            throw std::runtime_error("Source name " + name + ": printf-style source names are not supported");
+        }
+        if (name[0] == '/') {
+            return name;
+        }
+        std::vector<std::string> candidates;
+        if (const char* prefix = std::getenv("HDF5_VDS_PREFIX")) {
+            candidates.push_back(std::string(prefix) + "/" + name);
+        }
+        size_t slash = vds_path.rfind('/');
+        if (slash != std::string::npos) {
+            candidates.push_back(vds_path.substr(0, slash + 1) + name);
+        }
+        candidates.push_back(name);
+        for (const auto& candidate : candidates) {
+            if (access(candidate.c_str(), R_OK) == 0) {
+                return candidate;
             }
-        } else {
-            buffer = new char[file_size];
         }
-        auto alloc_end = std::chrono::high_resolution_clock::now();
-        auto alloc_duration = std::chrono::duration_cast<std::chrono::microseconds>(alloc_end - alloc_start);
-        std::cout << "Buffer allocation: " << alloc_duration.count() << " μs\n";
-
-        // Parallel memset using dedicated threads
-        auto memset_start = std::chrono::high_resolution_clock::now();
+        throw std::runtime_error("Source file not found: " + name);
+    }
 
-        size_t memset_chunk_size = file_size / num_threads;
-        size_t memset_remainder = file_size % num_threads;
+    void resolve() {
+        H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);  // Failures surface as exceptions instead
+        H5Handle file(H5Fopen(vds_path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose, "open " + vds_path);
+        H5Handle dset(H5Dopen2(file, dataset_name.c_str(), H5P_DEFAULT), H5Dclose, "open dataset " + dataset_name);
+        H5Handle dcpl(H5Dget_create_plist(dset), H5Pclose, "get the creation properties");
+        H5Handle type(H5Dget_type(dset), H5Tclose, "get the datatype");
+        H5Handle space(H5Dget_space(dset), H5Sclose, "get the dataspace");
 
-        std::vector<std::thread> memset_threads;
-        size_t current_memset_offset = 0;
+        if (H5Pget_layout(dcpl) != H5D_VIRTUAL) {
+            throw std::runtime_error(dataset_name + " in " + vds_path + " is not a virtual dataset");
+        }
+        int rank = H5Sget_simple_extent_ndims(space);
+        if (rank < 1) {
+            throw std::runtime_error(dataset_name + ": scalar datasets are not supported");
+        }
+        shape.resize(rank);
+        H5Sget_simple_extent_dims(space, shape.data(), nullptr);
+        element_size = H5Tget_size(type);
+        frame_bytes = element_size;
+        for (int d = 1; d < rank; ++d) {
+            frame_bytes *= shape[d];
+        }
+        fill_value.assign(element_size, 0);
+        H5Pget_fill_value(dcpl, type, fill_value.data());
 
-        for (size_t i = 0; i < num_threads; ++i) {
-            size_t current_chunk_size = memset_chunk_size;
+        size_t count = 0;
+        if (H5Pget_virtual_count(dcpl, &count) < 0) {
+            throw std::runtime_error("HDF5: failed to count the virtual mappings");
+        }
+        for (size_t i = 0; i < count; ++i) {
+            H5Handle vspace(H5Pget_virtual_vspace(dcpl, i), H5Sclose, "get a virtual selection");
+            H5Handle sspace(H5Pget_virtual_srcspace(dcpl, i), H5Sclose, "get a source selection");
+            std::string source(H5Pget_virtual_filename(dcpl, i, nullptr, 0), '\0');
+            H5Pget_virtual_filename(dcpl, i, &source[0], source.size() + 1);
+            std::string source_dataset(H5Pget_virtual_dsetname(dcpl, i, nullptr, 0), '\0');
+            H5Pget_virtual_dsetname(dcpl, i, &source_dataset[0], source_dataset.size() + 1);
+            std::string what = "Mapping " + std::to_string(i) + " (" + source + ":" + source_dataset + ")";
 
-            // Give the last thread any remaining bytes
-            if (i == num_threads - 1) {
-                current_chunk_size += memset_remainder;
+            auto target = frameBlock(vspace, what);
+            if (target.second == 0) {
+                continue;
             }
 
-            memset_threads.emplace_back([this, i, current_memset_offset, current_chunk_size]() {
-                auto thread_memset_start = std::chrono::high_resolution_clock::now();
-                std::memset(buffer + current_memset_offset, 0, current_chunk_size);
-                auto thread_memset_end = std::chrono::high_resolution_clock::now();
-                auto thread_memset_duration = std::chrono::duration_cast<std::chrono::milliseconds>(thread_memset_end - thread_memset_start);
-                std::cout << "Memset thread " << i << ": " << current_chunk_size << " bytes in " << thread_memset_duration.count() << " ms\n";
-            });
-
-            current_memset_offset += current_chunk_size;
+            Mapping mapping{resolveSource(source), source_dataset, target.first, target.second, 0, false,
+                            std::vector<char>(element_size, 0)};
+            H5Handle source_file(H5Fopen(mapping.source.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose,
+                                 "open " + mapping.source);
+            H5Handle source_dset(H5Dopen2(source_file, source_dataset.c_str(), H5P_DEFAULT), H5Dclose,
+                                 "open " + mapping.source + ":" + source_dataset);
+            H5Handle source_dcpl(H5Dget_create_plist(source_dset), H5Pclose, "get the source creation properties");
+            H5Handle source_type(H5Dget_type(source_dset), H5Tclose, "get the source datatype");
+            H5Handle source_space(H5Dget_space(source_dset), H5Sclose, "get the source dataspace");
+            if (H5Pget_layout(source_dcpl) != H5D_CONTIGUOUS) {
+                throw std::runtime_error(what + ": source storage is not contiguous (chunked or compact)");
+            }
+            if (H5Tequal(source_type, type) <= 0) {
+                throw std::runtime_error(what + ": source datatype differs from the virtual dataset's");
+            }
+            std::vector<hsize_t> source_shape(rank);
+            if (H5Sget_simple_extent_ndims(source_space) != rank) {
+                throw std::runtime_error(what + ": source rank differs from the virtual dataset's");
+            }
+            H5Sget_simple_extent_dims(source_space, source_shape.data(), nullptr);
+            if (!std::equal(source_shape.begin() + 1, source_shape.end(), shape.begin() + 1)) {
+                throw std::runtime_error(what + ": source frames differ in shape from the virtual dataset's");
+            }
+            // A select-all source selection is stored without an extent: it is the whole source
+            std::pair<size_t, size_t> from(0, source_shape[0]);
+            if (H5Sget_select_type(sspace) != H5S_SEL_ALL) {
+                from = frameBlock(sspace, what);
+            }
+            if (from.second != target.second || from.first + from.second > source_shape[0]) {
+                throw std::runtime_error(what + ": source extent does not match its mapping");
+            }
+            H5Pget_fill_value(source_dcpl, type, mapping.fill.data());
+            haddr_t address = H5Dget_offset(source_dset);
+            if (address != HADDR_UNDEF) {
+                mapping.file_offset = address + from.first * frame_bytes;
+                mapping.allocated = true;
+            }
+            mappings.push_back(mapping);
         }
+    }
 
-        // Wait for all memset threads to complete
-        for (auto& thread : memset_threads) {
-            thread.join();
+    void fillFrames(size_t first_frame, size_t frames, const std::vector<char>& value) {
+        char* dest = batch_reader->getConcatenatedBuffer() + first_frame * frame_bytes;
+        size_t length = frames * frame_bytes;
+        if (std::all_of(value.begin(), value.end(), [](char c) { return c == 0; })) {
+            std::memset(dest, 0, length);
+        } else {
+            for (size_t i = 0; i < length; i += element_size) {
+                std::memcpy(dest + i, value.data(), element_size);
+            }
         }
+    }
 
-        auto memset_end = std::chrono::high_resolution_clock::now();
-        auto memset_duration = std::chrono::duration_cast<std::chrono::milliseconds>(memset_end - memset_start);
-        std::cout << "Parallel memset total: " << memset_duration.count() << " ms\n";
+public:
+    VdsReader(const std::string& fname,
+              const std::string& dataset = "data",
+              size_t threads = std::thread::hardware_concurrency(),
+              size_t chunk_size = 1024 * 1024,
+              bool odirect = false)
+        : vds_path(fname), dataset_name(dataset), num_threads(threads), read_chunk_size(chunk_size),
+          use_odirect(odirect) {
+        resolve();
 
-        std::cout << "Reading file: " << filename << "\n";
-        std::cout << "File size: " << file_size << " bytes ("
-                  << (file_size / (1024.0 * 1024.0)) << " MB)\n";
-        std::cout << "Using " << num_threads << " threads\n";
-        std::cout << "Read chunk size: " << read_chunk_size << " bytes ("
-                  << (read_chunk_size / 1024.0) << " KB)\n";
-        std::cout << "O_DIRECT: " << (use_odirect ? "enabled" : "disabled");
-        if (use_odirect) {
-            std::cout << " (bypasses page cache - shows TRUE storage performance)";
-        } else {
-            std::cout << " (uses page cache - may show cached performance on repeat runs)";
+        std::cout << "VDS " << vds_path << ":" << dataset_name << ", shape (";
+        for (size_t d = 0; d < shape.size(); ++d) {
+            std::cout << (d ? ", " : "") << shape[d];
+        }
+        std::cout << "), " << element_size << " bytes per element, " << mappings.size() << " mapped sources\n";
+        for (const auto& mapping : mappings) {
+            std::cout << "  frames [" << mapping.first_frame << ", " << mapping.first_frame + mapping.frames
+                      << ") <- " << mapping.source << ":" << mapping.dataset;
+            if (mapping.allocated) {
+                std::cout << " at byte " << mapping.file_offset << "\n";
+            } else {
+                std::cout << " (not allocated, fill value)\n";
+            }
         }
-        std::cout << "\n";
 
-        // Calculate chunk size for each thread
-        size_t chunk_size = file_size / num_threads;
-        size_t remainder = file_size % num_threads;
+        std::vector<BatchFileReader::Range> ranges;
+        for (const auto& mapping : mappings) {
+            if (mapping.allocated) {
+                ranges.push_back(BatchFileReader::Range{mapping.source, mapping.file_offset,
+                                                        mapping.frames * frame_bytes,
+                                                        mapping.first_frame * frame_bytes});
+            }
+        }
+        if (ranges.empty()) {
+            throw std::runtime_error(dataset_name + ": no source has any data");
+        }
+        batch_reader.reset(new BatchFileReader(ranges, getSize(), num_threads, read_chunk_size, use_odirect));
+    }
 
-        std::vector<std::thread> threads;
-        size_t current_offset = 0;
+    void setThreadPool(std::shared_ptr<ThreadPool> shared_pool) {
+        batch_reader->setThreadPool(std::move(shared_pool));
+    }
 
-        auto start = std::chrono::high_resolution_clock::now();
-        // Create and launch threads
-        for (size_t i = 0; i < num_threads; ++i) {
-            size_t current_chunk_size = chunk_size;
+    void read() {
+        batch_reader->read();
 
-            // Give the last thread any remaining bytes
-            if (i == num_threads - 1) {
-                current_chunk_size += remainder;
+        // Frames without data: not mapped, or mapped to a source never written
+        std::vector<bool> mapped(shape[0], false);
+        size_t filled = 0;
+        for (const auto& mapping : mappings) {
+            std::fill(mapped.begin() + mapping.first_frame, mapped.begin() + mapping.first_frame + mapping.frames,
+                      true);
+            if (!mapping.allocated) {
+                fillFrames(mapping.first_frame, mapping.frames, mapping.fill);
+                filled += mapping.frames;
             }
-
-            threads.emplace_back(&ParallelFileReader::readChunk, this,
-                               i, current_offset, current_chunk_size);
-
-            current_offset += current_chunk_size;
         }
-
-        // Wait for all threads to complete
-        for (auto& thread : threads) {
-            thread.join();
+        for (size_t frame = 0; frame < shape[0]; ++frame) {
+            if (!mapped[frame]) {
+                fillFrames(frame, 1, fill_value);
+                ++filled;
+            }
+        }
+        if (filled > 0) {
+            std::cout << filled << " frames without source data were set to the fill value\n";
         }
-
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-        std::cout << "\nRead completed in " << duration.count() << " ms\n";
-        double throughput = (file_size / (1024.0 * 1024.0)) / (duration.count() / 1000.0);
-        std::cout << "Throughput: " << throughput << " MB/s\n";
     }
 
-    // Get the buffer (for verification or further processing)
     const char* getBuffer() const {
-        return buffer;
+        return batch_reader->getConcatenatedBuffer();
     }
 
-    size_t getFileSize() const {
-        return file_size;
+    size_t getSize() const {
+        return shape[0] * frame_bytes;
+    }
+
+    const std::vector<hsize_t>& getShape() const {
+        return shape;
     }
 
-    // Verify the read by comparing with sequential read
+    // Read the dataset again through libhdf5's own VDS path, in blocks of frames,
+    // and compare. Also times that path for comparison with ours
     bool verify() {
-        std::cout << "\nVerifying parallel read...\n";
+        std::cout << "\nVerifying against libhdf5 H5Dread...\n";
+        H5Handle file(H5Fopen(vds_path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose, "open " + vds_path);
+        H5Handle dset(H5Dopen2(file, dataset_name.c_str(), H5P_DEFAULT), H5Dclose, "open dataset " + dataset_name);
+        H5Handle type(H5Dget_type(dset), H5Tclose, "get the datatype");
+        H5Handle space(H5Dget_space(dset), H5Sclose, "get the dataspace");
 
-        // Use regular file I/O for verification (not O_DIRECT) to avoid alignment issues
-        std::ifstream file(filename, std::ios::binary);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file for verification\n";
-            return false;
+        size_t block_frames = std::max<size_t>(1, (64 * 1024 * 1024) / std::max<size_t>(frame_bytes, 1));
+        std::vector<char> expected(std::min<size_t>(block_frames, shape[0]) * frame_bytes);
+        const char* buffer = getBuffer();
+        bool match = true;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t frame = 0; frame < shape[0] && match; frame += block_frames) {
+            size_t frames = std::min(block_frames, static_cast<size_t>(shape[0]) - frame);
+            std::vector<hsize_t> offset(shape.size(), 0), count(shape);
+            offset[0] = frame;
+            count[0] = frames;
+            H5Handle memspace(H5Screate_simple(static_cast<int>(shape.size()), count.data(), nullptr), H5Sclose,
+                              "create the memory dataspace");
+            if (H5Sselect_hyperslab(space, H5S_SELECT_SET, offset.data(), nullptr, count.data(), nullptr) < 0
+                || H5Dread(dset, type, memspace, space, H5P_DEFAULT, expected.data()) < 0) {
+                throw std::runtime_error("HDF5: failed to read frames from " + std::to_string(frame));
+            }
+            for (size_t i = 0; i < frames; ++i) {
+                if (std::memcmp(buffer + (frame + i) * frame_bytes, expected.data() + i * frame_bytes,
+                                frame_bytes) != 0) {
+                    std::cout << "Mismatch at frame " << frame + i << "\n";
+                    match = false;
+                    break;
+                }
+            }
         }
-
-        char* verify_buffer = new char[file_size];
-        file.read(verify_buffer, file_size);
-        file.close();
-
-        bool success = file.gcount() == static_cast<std::streamsize>(file_size);
-        bool match = success && (std::memcmp(buffer, verify_buffer, file_size) == 0);
-        delete[] verify_buffer;
+        auto end = std::chrono::high_resolution_clock::now();
 
         if (match) {
-            std::cout << "Verification PASSED: Parallel read matches sequential read\n";
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            std::cout << "libhdf5 read and compare took " << duration.count() << " ms ("
+                      << (getSize() / (1024.0 * 1024.0)) / (std::max<long>(duration.count(), 1) / 1000.0)
+                      << " MB/s)\n";
+            std::cout << "Verification PASSED: VDS read matches libhdf5\n";
         } else {
             std::cout << "Verification FAILED: Data mismatch detected\n";
         }
-
         return match;
     }
 };
+#endif
 
 int main(int argc, char* argv[]) {
     try {
         std::string filename;
-        size_t num_threads = std::thread::hardware_concurrency();
+        size_t num_threads = 0;  // 0: chosen by the reader from the device and page cache
         size_t read_chunk_size = 1024 * 1024; // Default 1MB
         bool use_odirect = false; // Default: don't use O_DIRECT
+        IoEngine io_engine = IoEngine::Sync;
+        unsigned queue_depth = 0;  // 0: 32, or chosen along with the thread count
+        size_t chunks_per_syscall = 1;
+        Scheduler scheduler = Scheduler::Static;
+        size_t repeat = 1;
+        BufferInit buffer_init = BufferInit::Memset;
+        NumaPolicy numa_policy = NumaPolicy::None;
+        ThreadPinning pinning = ThreadPinning::None;
+        HugePages huge_pages = HugePages::None;
+        CacheAdvice cache_advice = CacheAdvice::None;
+        size_t readahead_kb = 0;
+        bool drop_behind = false;
+        size_t stream_chunks = 0;  // 0: whole-file read(); otherwise the stream() pool size
+        size_t process_threads = 0;  // 0: plain read(); otherwise process() consumer threads
+        bool async_read = false;
+        bool cache_aware = false;
+        bool checksum = false;
+        std::string manifest_path;
+        bool batch = false;
+        bool concatenate = false;
+        size_t file_depth = 0;
+        std::string vds_dataset;
+        std::string write_manifest_path;
+        size_t manifest_block_mb = 64;
+        bool hybrid_direct = false;
+        size_t direct_min_mb = 16;
+        bool stream_in_order = true;
+
+        // Positional arguments come first; --name=value options may appear anywhere
+        std::vector<std::string> args;
+        std::vector<std::pair<std::string, std::string>> options;
+        bool auto_tune = false;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) == 0) {
+                size_t eq = arg.find('=');
+                options.emplace_back(arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2),
+                                     eq == std::string::npos ? "" : arg.substr(eq + 1));
+            } else {
+                args.push_back(arg);
+            }
+        }
 
-        if (argc < 2) {
-            std::cout << "Usage: " << argv[0] << " <filename> [num_threads] [read_chunk_size_KB] [use_odirect]\n";
-            std::cout << "Example: " << argv[0] << " large_file.bin 8 1024 1\n";
+        if (args.empty()) {
+            std::cout << "Usage: " << argv[0] << " <filename> [num_threads] [read_chunk_size_KB] [use_odirect] [io_engine] [queue_depth]\n";
+            std::cout << "Example: " << argv[0] << " large_file.bin 8 1024 1 uring 64\n";
             std::cout << "  - filename: file to read\n";
-            std::cout << "  - num_threads: number of parallel threads (default: CPU cores)\n";
-            std::cout << "  - read_chunk_size_KB: size of each read operation in KB (default: 1024 = 1MB)\n";
+            std::cout << "  - num_threads: number of parallel threads, or auto to choose from the device type, its queue and how much of the file is cached (default: auto)\n";
+            std::cout << "  - read_chunk_size_KB: size of each read operation in KB, or auto to time a few sizes on the first read and cache the fastest per mount (default: 1024 = 1MB)\n";
             std::cout << "  - use_odirect: 1 to use O_DIRECT, 0 to use regular I/O (default: 0)\n";
+            std::cout << "  - io_engine: sync for one blocking read per thread, uring for io_uring, mmap to map and prefault the file (default: sync)\n";
+            std::cout << "  - queue_depth: reads kept in flight per thread with io_uring (default: 32, or chosen with an auto thread count)\n";
+            std::cout << "Options:\n";
+            std::cout << "  --chunks-per-syscall=N: chunks filled by each preadv on the sync engine (default: 1)\n";
+            std::cout << "  --scheduler=static|dynamic: fixed section per thread, or claim chunks from a shared cursor (default: static)\n";
+            std::cout << "  --buffer-init=memset|first-touch: zero the buffer before reading, or let readers fault it in (default: memset)\n";
+            std::cout << "  --numa=none|local|interleave: bind each thread's section of the buffer to its node, or interleave it (default: none)\n";
+            std::cout << "  --pin=none|node|core: pin reader threads to a NUMA node or a single core (default: none)\n";
+            std::cout << "  --huge-pages=none|thp|2m|1g: back the buffer with transparent or hugetlb huge pages (default: none)\n";
+            std::cout << "  --fadvise=normal|sequential|random|noreuse|willneed: posix_fadvise hint for buffered reads (default: none)\n";
+            std::cout << "  --readahead=KB: keep readahead() this far ahead of each thread's buffered reads (default: 0, kernel readahead only)\n";
+            std::cout << "  --drop-behind: POSIX_FADV_DONTNEED each range once read, so a one-pass read does not evict other cached data\n";
+            std::cout << "  --stream=N: stream through a pool of N chunk buffers instead of a file-sized buffer (default: off)\n";
+            std::cout << "  --stream-order=in|any: deliver streamed chunks in file order or as they complete (default: in)\n";
+            std::cout << "  --process=N: count newlines on N consumer threads while the file is still being read (default: off)\n";
+            std::cout << "  --async: read with read_async() and report when the first chunk becomes available\n";
+            std::cout << "  --cache-aware: read uncached ranges first (O_DIRECT if enabled) and copy cached ranges with buffered reads\n";
+            std::cout << "  --hybrid[=MB]: with O_DIRECT, read unaligned section edges and files under MB megabytes buffered (default: off, 16 MB)\n";
+            std::cout << "  --checksum: CRC32C each chunk as it is read and print the whole-file digest\n";
+            std::cout << "  --manifest=PATH: check each block against a manifest of CRC32C digests as it is read, re-read failing blocks and skip verify()\n";
+            std::cout << "  --write-manifest=PATH: write a manifest of the file's block digests after reading\n";
+            std::cout << "  --manifest-block=MB: block size for --write-manifest (default: 64)\n";
+            std::cout << "  --batch: filename is a list of files, one per line, read together with chunks interleaved across files\n";
+            std::cout << "  --concat: with --batch, read all files into one concatenated buffer\n";
+            std::cout << "  --file-depth=N: with --batch, keep at most N reads of any one file in flight (default: 0, no limit)\n";
+            std::cout << "  --vds[=DATASET]: filename is an HDF5 virtual dataset (default DATASET: data), assembled by reading its sources directly\n";
+            std::cout << "  --repeat=N: read the file N times, reusing the buffer and thread pool (default: 1)\n";
             return 1;
         }
 
-        filename = argv[1];
+        filename = args[0];
 
-        if (argc >= 3) {
-            num_threads = std::stoul(argv[2]);
+        if (args.size() >= 2) {
+            num_threads = args[1] == "auto" ? 0 : std::stoul(args[1]);
         }
 
-        if (argc >= 4) {
-            read_chunk_size = std::stoul(argv[3]) * 1024; // Convert KB to bytes
+        if (args.size() >= 3) {
+            if (args[2] == "auto") {
+                auto_tune = true;
+            } else {
+                read_chunk_size = std::stoul(args[2]) * 1024; // Convert KB to bytes
+            }
         }
 
-        if (argc >= 5) {
-            use_odirect = std::stoul(argv[4]) != 0;
+        if (args.size() >= 4) {
+            use_odirect = std::stoul(args[3]) != 0;
         }
 
-        if (num_threads == 0) {
-            num_threads = 1;
+        if (args.size() >= 5) {
+            std::string engine = args[4];
+            if (engine == "uring" || engine == "io_uring") {
+                io_engine = IoEngine::IoUring;
+            } else if (engine == "mmap") {
+                io_engine = IoEngine::Mmap;
+            } else if (engine != "sync") {
+                throw std::runtime_error("Unknown io_engine: " + engine);
+            }
+        }
+
+        if (args.size() >= 6) {
+            queue_depth = std::stoul(args[5]);
+        }
+
+        for (const auto& option : options) {
+            if (option.first == "chunks-per-syscall") {
+                chunks_per_syscall = std::stoul(option.second);
+            } else if (option.first == "scheduler") {
+                if (option.second == "dynamic") {
+                    scheduler = Scheduler::Dynamic;
+                } else if (option.second != "static") {
+                    throw std::runtime_error("Unknown scheduler: " + option.second);
+                }
+            } else if (option.first == "buffer-init") {
+                if (option.second == "first-touch") {
+                    buffer_init = BufferInit::FirstTouch;
+                } else if (option.second != "memset") {
+                    throw std::runtime_error("Unknown buffer-init mode: " + option.second);
+                }
+            } else if (option.first == "numa") {
+                if (option.second == "local") {
+                    numa_policy = NumaPolicy::Local;
+                } else if (option.second == "interleave") {
+                    numa_policy = NumaPolicy::Interleave;
+                } else if (option.second != "none") {
+                    throw std::runtime_error("Unknown NUMA policy: " + option.second);
+                }
+            } else if (option.first == "pin") {
+                if (option.second == "node") {
+                    pinning = ThreadPinning::Node;
+                } else if (option.second == "core") {
+                    pinning = ThreadPinning::Core;
+                } else if (option.second != "none") {
+                    throw std::runtime_error("Unknown thread pinning: " + option.second);
+                }
+            } else if (option.first == "huge-pages") {
+                if (option.second == "thp") {
+                    huge_pages = HugePages::Transparent;
+                } else if (option.second == "2m") {
+                    huge_pages = HugePages::Huge2MB;
+                } else if (option.second == "1g") {
+                    huge_pages = HugePages::Huge1GB;
+                } else if (option.second != "none") {
+                    throw std::runtime_error("Unknown huge-pages mode: " + option.second);
+                }
+            } else if (option.first == "fadvise") {
+                if (option.second == "normal") {
+                    cache_advice = CacheAdvice::Normal;
+                } else if (option.second == "sequential") {
+                    cache_advice = CacheAdvice::Sequential;
+                } else if (option.second == "random") {
+                    cache_advice = CacheAdvice::Random;
+                } else if (option.second == "noreuse") {
+                    cache_advice = CacheAdvice::NoReuse;
+                } else if (option.second == "willneed") {
+                    cache_advice = CacheAdvice::WillNeed;
+                } else if (option.second != "none") {
+                    throw std::runtime_error("Unknown fadvise policy: " + option.second);
+                }
+            } else if (option.first == "readahead") {
+                readahead_kb = std::stoul(option.second);
+            } else if (option.first == "drop-behind") {
+                drop_behind = true;
+            } else if (option.first == "stream") {
+                stream_chunks = std::stoul(option.second);
+            } else if (option.first == "stream-order") {
+                if (option.second == "any") {
+                    stream_in_order = false;
+                } else if (option.second != "in") {
+                    throw std::runtime_error("Unknown stream order: " + option.second);
+                }
+            } else if (option.first == "process") {
+                process_threads = std::stoul(option.second);
+            } else if (option.first == "async") {
+                async_read = true;
+            } else if (option.first == "cache-aware") {
+                cache_aware = true;
+            } else if (option.first == "hybrid") {
+                hybrid_direct = true;
+                if (!option.second.empty()) {
+                    direct_min_mb = std::stoul(option.second);
+                }
+            } else if (option.first == "checksum") {
+                checksum = true;
+            } else if (option.first == "manifest") {
+                manifest_path = option.second;
+            } else if (option.first == "write-manifest") {
+                write_manifest_path = option.second;
+            } else if (option.first == "manifest-block") {
+                manifest_block_mb = std::max<size_t>(1, std::stoul(option.second));
+            } else if (option.first == "batch") {
+                batch = true;
+            } else if (option.first == "concat") {
+                concatenate = true;
+            } else if (option.first == "file-depth") {
+                file_depth = std::stoul(option.second);
+            } else if (option.first == "vds") {
+                vds_dataset = option.second.empty() ? "data" : option.second;
+            } else if (option.first == "repeat") {
+                repeat = std::max<size_t>(1, std::stoul(option.second));
+            } else {
+                throw std::runtime_error("Unknown option: --" + option.first);
+            }
         }
 
         if (read_chunk_size == 0) {
             read_chunk_size = 1024 * 1024; // Default to 1MB
         }
 
-        ParallelFileReader reader(filename, num_threads, read_chunk_size, use_odirect);
-        reader.read();
+        if (!vds_dataset.empty()) {
+#ifdef WITH_HDF5
+            VdsReader vds_reader(filename, vds_dataset,
+                                 num_threads > 0 ? num_threads : std::thread::hardware_concurrency(),
+                                 read_chunk_size, use_odirect);
+            for (size_t i = 0; i < repeat; ++i) {
+                vds_reader.read();
+            }
+            return vds_reader.verify() ? 0 : 1;
+#else
+            throw std::runtime_error("--vds needs a build with HDF5 (-DWITH_HDF5, see build.sh)");
+#endif
+        }
+
+        if (batch) {
+            std::ifstream list(filename);
+            if (!list.is_open()) {
+                throw std::runtime_error("Failed to open file list: " + filename);
+            }
+            std::vector<std::string> names;
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty() && line[0] != '#') {
+                    names.push_back(line);
+                }
+            }
+            BatchFileReader batch_reader(names, num_threads > 0 ? num_threads : std::thread::hardware_concurrency(),
+                                         read_chunk_size, use_odirect);
+            batch_reader.setConcatenated(concatenate);
+            batch_reader.setMaxInFlightPerFile(file_depth);
+            for (size_t i = 0; i < repeat; ++i) {
+                batch_reader.read();
+            }
+            return batch_reader.verify() ? 0 : 1;
+        }
+
+        ParallelFileReader reader(filename, num_threads, read_chunk_size, use_odirect, io_engine, queue_depth);
+        reader.setChunksPerSyscall(chunks_per_syscall);
+        reader.setScheduler(scheduler);
+        reader.setBufferInit(buffer_init);
+        reader.setNumaPlacement(numa_policy, pinning);
+        reader.setHugePages(huge_pages);
+        reader.setAutoTune(auto_tune);
+        reader.setCacheAware(cache_aware);
+        reader.setHybridDirect(hybrid_direct, direct_min_mb * 1024 * 1024);
+        reader.setCacheAdvice(cache_advice, readahead_kb * 1024, drop_behind);
+        reader.setChecksum(checksum || !write_manifest_path.empty());
+        if (!write_manifest_path.empty()) {
+            reader.setDigestBlockSize(manifest_block_mb * 1024 * 1024);
+        }
+        if (!manifest_path.empty()) {
+            reader.setManifest(manifest_path);
+        }
+
+        if (stream_chunks > 0) {
+            // The consumer only counts chunks and keeps the file's first bytes
+            std::vector<char> head;
+            size_t chunks = 0;
+            bool complete = reader.stream(stream_chunks, [&](size_t offset, const char* data, size_t length) {
+                ++chunks;
+                if (offset == 0) {
+                    head.assign(data, data + std::min(size_t(64), length));
+                }
+            }, stream_in_order);
+            std::cout << "Consumer received " << chunks << " chunks" << (complete ? "" : " (incomplete)") << "\n";
+
+            std::cout << "\nFirst 64 bytes of file (hex):\n";
+            for (size_t i = 0; i < head.size(); ++i) {
+                printf("%02x ", static_cast<unsigned char>(head[i]));
+                if ((i + 1) % 16 == 0) std::cout << "\n";
+            }
+            std::cout << "\n";
+            return complete ? 0 : 1;
+        }
+
+        for (size_t i = 0; i < repeat; ++i) {
+            if (repeat > 1) {
+                std::cout << "\n=== Read " << (i + 1) << " of " << repeat << " ===\n";
+            }
+            if (process_threads > 0) {
+                // Stand-in for parsing: count the newlines in each chunk as it arrives
+                std::atomic<size_t> lines{0};
+                reader.process(process_threads, [&](size_t, const char* data, size_t length) {
+                    lines += std::count(data, data + length, '\n');
+                });
+                std::cout << "Newlines: " << lines << "\n";
+            } else if (async_read) {
+                auto async_start = std::chrono::high_resolution_clock::now();
+                auto progress = reader.read_async();
+                size_t first_chunk = std::min(read_chunk_size, reader.getFileSize());
+                bool first_ready = progress->waitRange(0, first_chunk);
+                auto first_end = std::chrono::high_resolution_clock::now();
+                progress->wait();
+                auto first_duration = std::chrono::duration_cast<std::chrono::microseconds>(first_end - async_start);
+                std::cout << "First chunk " << (first_ready ? "available" : "never read") << " after "
+                          << first_duration.count() << " μs\n";
+            } else {
+                reader.read();
+            }
+        }
+
+        if (!write_manifest_path.empty()) {
+            reader.writeManifest(write_manifest_path);
+            std::cout << "Manifest written to " << write_manifest_path << "\n";
+        }
 
-        // Optional: Verify the read
-        reader.verify();
+        // Optional: Verify the read; a manifest has already checked every block
+        bool intact = true;
+        if (manifest_path.empty()) {
+            reader.verify();
+        } else {
+            intact = reader.getCorruptBlocks().empty();
+        }
 
         // Optional: Print first few bytes
         std::cout << "\nFirst 64 bytes of buffer (hex):\n";
@@ -375,6 +4228,9 @@ int main(int argc, char* argv[]) {
             if ((i + 1) % 16 == 0) std::cout << "\n";
         }
         std::cout << "\n";
+        if (!intact) {
+            return 1;
+        }
 
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";